@@ -1,4 +1,5 @@
 #include "Application.h"
+#include "Encode.h"
 #include <bit>
 #include <sstream>
 #include <vector>
@@ -27,6 +28,11 @@ Application::~Application()
 // void Application::Run(const Core::Mesh& mesh, const Core::VirtualMesh& vmesh)
 void Application::Run(std::vector<uint32_t>& packedData)
 {
+    // the shaders read the records as PackedLayout lays them out, data of another format would be misread.
+    if (!Core::Encode::IsPackedHeaderValid(packedData)) {
+        throw std::runtime_error("the packed data is not in the current format");
+    }
+
     CreateCamera();
     CreateCommandBuffer();
 
@@ -101,7 +107,7 @@ void Application::CreateInstanceBuffers(std::vector<uint32_t>& packedData)
 {
     _clustersNum = packedData[0];
     _groupsNum = packedData[1];
-    float radius = std::abs(Util::Uint2Float(packedData[packedData[2] + 8 * (_groupsNum - 1) + 7]));
+    float radius = std::abs(Util::Uint2Float(packedData[packedData[2] + Core::PackedLayout::groupWords * (_groupsNum - 1) + Core::PackedLayout::groupLodBounds + 3]));
     _modelScale = pow(10, -std::floor(std::log10(radius)));
     //std::cout << radius << " " << _modelScale << "\n";
 
@@ -384,6 +390,7 @@ void Application::CreateGraphicsPipeline(uint32_t pushConstantSize, bool isWireF
         info.viewHeight = _swapchain->GetExtent().height;
         info.useInstance = true;
         info.shaderName = { "shaders/shaderInstance.vert", "shaders/shader.frag" };
+        info.shaderDefines = Core::Encode::PackedLayoutDefines();
         info.compareOp = VK_COMPARE_OP_GREATER;
         info.pushConstantSize = pushConstantSize;
         info.colorAttachmentFormats = std::vector<VkFormat>{ _swapchain->GetImageFormat() };
@@ -405,7 +412,7 @@ void Application::CreateGraphicsPipeline(uint32_t pushConstantSize, bool isWireF
 }
 
 void Application::CreateComputePipeline(uint32_t pushConstantSize) {
-    _computePipeline = new ComputePipeline(*_device, *_descriptorSetManager, pushConstantSize);
+    _computePipeline = new ComputePipeline(*_device, *_descriptorSetManager, pushConstantSize, Core::Encode::PackedLayoutDefines());
 }
 
 void Application::BeginRender(VkCommandBuffer cmd, const RenderPassInfo& renderPassInfo)
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "timer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace Bench {
+// bumped by the global operator new replacements in Allocations.cpp.
+extern std::atomic<uint64_t> allocationCount;
+extern std::atomic<uint64_t> allocationBytes;
+
+struct Result {
+    std::string stage;
+    std::string mesh;
+    std::string unit;
+    double seconds; // median of the repeats
+    double throughput; // units / s
+    double allocations; // per run
+    double allocatedBytes; // per run
+};
+
+class Runner final {
+public:
+    Runner(uint32_t repeats)
+        : _repeats(repeats)
+    {
+    }
+
+    // setup runs untimed before every repeat, run is measured; units is the work done by one run.
+    void Run(const std::string& stage, const std::string& mesh, const std::string& unit, double units,
+        const std::function<void()>& setup, const std::function<void()>& run)
+    {
+        std::vector<double> times;
+        times.reserve(_repeats);
+        uint64_t allocations = 0, bytes = 0;
+        for (uint32_t i = 0; i < _repeats; i++) {
+            if (setup)
+                setup();
+            uint64_t allocations0 = allocationCount, bytes0 = allocationBytes;
+            Util::Timer timer;
+            run();
+            times.push_back(timer.timeDuration() * 0.000001);
+            allocations += allocationCount - allocations0;
+            bytes += allocationBytes - bytes0;
+        }
+        std::sort(times.begin(), times.end());
+
+        Result result;
+        result.stage = stage;
+        result.mesh = mesh;
+        result.unit = unit;
+        result.seconds = times[times.size() / 2];
+        result.throughput = result.seconds > 0 ? units / result.seconds : 0;
+        result.allocations = double(allocations) / _repeats;
+        result.allocatedBytes = double(bytes) / _repeats;
+        _results.push_back(result);
+
+        char line[256];
+        snprintf(line, sizeof(line), "%-22s %-14s %10.3f ms %14.0f %-7s %10.0f allocs %12.0f bytes\n",
+            stage.c_str(), mesh.c_str(), result.seconds * 1000, result.throughput, (unit + "/s").c_str(), result.allocations, result.allocatedBytes);
+        std::cout << line;
+    }
+
+    const std::vector<Result>& GetResults() const { return _results; }
+
+    // one tab separated line per result, easy to diff and to read back.
+    bool SaveBaseline(const std::string& fileName) const
+    {
+        std::ofstream out(fileName);
+        for (const auto& result : _results) {
+            out << result.stage << "\t" << result.mesh << "\t" << result.unit << "\t" << result.seconds << "\t"
+                << result.throughput << "\t" << result.allocations << "\t" << result.allocatedBytes << "\n";
+        }
+        return static_cast<bool>(out);
+    }
+
+    bool CompareBaseline(const std::string& fileName) const
+    {
+        std::ifstream in(fileName);
+        if (!in)
+            return false;
+
+        std::map<std::string, Result> baseline;
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream ss(line);
+            Result result;
+            std::getline(ss, result.stage, '\t');
+            std::getline(ss, result.mesh, '\t');
+            std::getline(ss, result.unit, '\t');
+            ss >> result.seconds >> result.throughput >> result.allocations >> result.allocatedBytes;
+            if (ss)
+                baseline[result.stage + "/" + result.mesh] = result;
+        }
+
+        std::cout << "\n--- Compare with " << fileName << " (time and allocations, + is slower / more) ---\n";
+        for (const auto& result : _results) {
+            auto it = baseline.find(result.stage + "/" + result.mesh);
+            if (it == baseline.end())
+                continue;
+            const auto& base = it->second;
+            char text[256];
+            snprintf(text, sizeof(text), "%-22s %-14s time %+7.1f%%   allocs %+7.1f%%\n", result.stage.c_str(), result.mesh.c_str(),
+                base.seconds > 0 ? (result.seconds / base.seconds - 1) * 100 : 0.0,
+                base.allocations > 0 ? (result.allocations / base.allocations - 1) * 100 : 0.0);
+            std::cout << text;
+        }
+        return true;
+    }
+
+private:
+    uint32_t _repeats;
+    std::vector<Result> _results;
+};
+}
@@ -0,0 +1,572 @@
+#include "Bench.h"
+#include "Cluster.h"
+#include "Encode.h"
+#include "HashTable.h"
+#include "Heap.h"
+#include "Mesh.h"
+#include "MeshSimplifier.h"
+#include "Partitioner.h"
+#include "Quadric.h"
+#include "VirtualMesh.h"
+#include "Weld.h"
+
+#include <cmath>
+#include <filesystem>
+#include <random>
+
+// Usage: bench [--repeats n] [--grid n] [--save baseline.tsv] [--compare baseline.tsv] [mesh files ...]
+// Runs every offline build stage on sphere2.obj (or the given meshes) and on generated grids.
+// Full builds on 1, 4 and all hardware threads must pack the same data, and lazy and independent set simplifications
+// must stay within the error tolerance of eager ones, and parent clusters built with a grown scratch must allocate nothing
+// but their own buffers; the exit code is -1 if any of these fails.
+
+// wavy height field of n * n quads, deterministic for a given n.
+static Core::Mesh GenerateGrid(uint32_t n)
+{
+    Core::Mesh mesh;
+    for (uint32_t y = 0; y <= n; y++) {
+        for (uint32_t x = 0; x <= n; x++) {
+            float u = float(x) / n, v = float(y) / n;
+            mesh.vertices.push_back({ u, v, 0.05f * std::sin(u * 25.f) * std::cos(v * 17.f) });
+        }
+    }
+    for (uint32_t y = 0; y < n; y++) {
+        for (uint32_t x = 0; x < n; x++) {
+            uint32_t i0 = y * (n + 1) + x, i1 = i0 + 1, i2 = i0 + n + 1, i3 = i2 + 1;
+            mesh.indices.insert(mesh.indices.end(), { i0, i1, i3, i0, i3, i2 });
+        }
+    }
+    return mesh;
+}
+
+
+static void BenchHashTable(Bench::Runner& runner, const std::string& name, const Core::Mesh& mesh)
+{
+    const uint32_t n = mesh.vertices.size();
+    std::vector<uint32_t> keys(n);
+    for (uint32_t i = 0; i < n; i++)
+        keys[i] = Util::HashTable::HashValue(mesh.vertices[i]);
+
+    Util::HashTable* table = nullptr;
+    auto fill = [&] {
+        delete table;
+        table = new Util::HashTable(n);
+        for (uint32_t i = 0; i < n; i++)
+            table->Add(keys[i], i);
+    };
+
+    runner.Run("hash-insert", name, "ops", n, [&] { delete table; table = nullptr; }, [&] { fill(); });
+
+    uint64_t found = 0;
+    runner.Run("hash-lookup", name, "ops", n, fill, [&] {
+        for (uint32_t i = 0; i < n; i++) {
+            for (auto j = table->First(keys[i]); table->IsValid(j); j = table->Next(j)) {
+                if (mesh.vertices[j] == mesh.vertices[i]) {
+                    found++;
+                    break;
+                }
+            }
+        }
+    });
+
+    runner.Run("hash-remove", name, "ops", n, fill, [&] {
+        for (uint32_t i = 0; i < n; i++)
+            table->Remove(keys[i], i);
+    });
+    delete table;
+}
+
+static void BenchHeap(Bench::Runner& runner, const std::string& name, uint32_t n)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> dist(0.f, 1.f);
+    std::vector<float> keys(n), updates(n);
+    for (auto& key : keys)
+        key = dist(rng);
+    for (auto& key : updates)
+        key = dist(rng);
+
+    Util::Heap heap;
+    auto fill = [&] {
+        heap.Resize(n);
+        for (uint32_t i = 0; i < n; i++)
+            heap.Add(keys[i], i);
+    };
+
+    runner.Run("heap-push", name, "ops", n, [&] { heap.Resize(n); }, [&] {
+        for (uint32_t i = 0; i < n; i++)
+            heap.Add(keys[i], i);
+    });
+    runner.Run("heap-build", name, "ops", n, nullptr, [&] { heap.Build(keys); });
+    runner.Run("heap-update", name, "ops", n, fill, [&] {
+        for (uint32_t i = 0; i < n; i++)
+            heap.Update(updates[i], i);
+    });
+    runner.Run("heap-pop", name, "ops", n, fill, [&] {
+        while (!heap.Empty())
+            heap.Pop();
+    });
+}
+
+// what Evaluate of the simplifiers does per collapse : sum the quadrics of the triangles around a vertex and
+// evaluate them at candidate positions, here the three corners of its first triangle.
+struct QuadricWork {
+    std::vector<uint32_t> offsets; // triangles of vertex i : triangles[offsets[i], offsets[i + 1])
+    std::vector<uint32_t> triangles;
+    std::vector<glm::vec3> candidates; // 3 per vertex
+};
+
+static QuadricWork BuildQuadricWork(const Core::Mesh& mesh)
+{
+    QuadricWork work;
+    work.offsets.assign(mesh.vertices.size() + 1, 0);
+    for (auto id : mesh.indices)
+        work.offsets[id + 1]++;
+    for (size_t i = 0; i < mesh.vertices.size(); i++)
+        work.offsets[i + 1] += work.offsets[i];
+    work.triangles.resize(mesh.indices.size());
+    std::vector<uint32_t> fill(work.offsets.begin(), work.offsets.end() - 1);
+    for (uint32_t corner = 0; corner < mesh.indices.size(); corner++)
+        work.triangles[fill[mesh.indices[corner]]++] = corner / 3;
+
+    work.candidates.resize(mesh.vertices.size() * 3);
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        for (uint32_t k = 0; k < 3; k++) {
+            work.candidates[i * 3 + k] = work.offsets[i] == work.offsets[i + 1]
+                ? mesh.vertices[i]
+                : mesh.vertices[mesh.indices[work.triangles[work.offsets[i]] * 3 + k]];
+        }
+    }
+    return work;
+}
+
+template <typename T>
+static void BenchQuadricStore(Bench::Runner& runner, const std::string& stage, const std::string& name, const Core::Mesh& mesh,
+    const QuadricWork& work, std::vector<float>& errors)
+{
+    const uint32_t triangleNum = mesh.indices.size() / 3;
+    const uint32_t vertNum = mesh.vertices.size();
+    Core::QuadricStore<T> store;
+    store.Resize(triangleNum);
+    for (uint32_t i = 0; i < triangleNum; i++)
+        store.Set(i, mesh.vertices[mesh.indices[i * 3 + 0]], mesh.vertices[mesh.indices[i * 3 + 1]], mesh.vertices[mesh.indices[i * 3 + 2]]);
+
+    errors.resize(vertNum * 3);
+    runner.Run(stage, name, "verts", vertNum, nullptr, [&] {
+        for (uint32_t i = 0; i < vertNum; i++) {
+            auto q = store.Accumulate(work.triangles.data() + work.offsets[i], work.offsets[i + 1] - work.offsets[i]);
+            Core::QuadricStore<T>::Evaluate(q, &work.candidates[i * 3], 3, &errors[i * 3]);
+        }
+    });
+}
+
+static void BenchQuadrics(Bench::Runner& runner, const std::string& name, const Core::Mesh& mesh)
+{
+    const QuadricWork work = BuildQuadricWork(mesh);
+    std::vector<float> doubleErrors, floatErrors;
+    BenchQuadricStore<double>(runner, "quadric-sum", name, mesh, work, doubleErrors);
+    BenchQuadricStore<float>(runner, "quadric-sum-float", name, mesh, work, floatErrors);
+
+    // relative to the largest error, near zero costs are where float loses most and matter least.
+    float maxError = 0, difference = 0;
+    for (size_t i = 0; i < doubleErrors.size(); i++) {
+        maxError = std::max(maxError, doubleErrors[i]);
+        difference = std::max(difference, std::abs(floatErrors[i] - doubleErrors[i]));
+    }
+    char line[256];
+    snprintf(line, sizeof(line), "%-22s %-14s max difference to double %g of the max error\n",
+        "quadric-sum-float", name.c_str(), maxError > 0 ? difference / maxError : 0.f);
+    std::cout << line;
+}
+
+static const Core::SimplifierConfig simplifierConfigs[] = {
+    { Core::SimplifierCore::PositionHash, false },
+    { Core::SimplifierCore::PositionHash, true },
+    { Core::SimplifierCore::CornerTable, false },
+    { Core::SimplifierCore::CornerTable, true },
+    { Core::SimplifierCore::IndependentSet, false },
+};
+
+// how much larger the max error of a lazy or independent set simplification may get than the eager serial one
+// before it (the same topology).
+static const float errorTolerance = 0.25f;
+
+// the eager position hash core keeps the plain stage names, so baselines saved before there were cores still compare.
+static std::string SimplifierStage(const std::string& stage, const Core::SimplifierConfig& config)
+{
+    const char* core = config.core == Core::SimplifierCore::CornerTable ? "-corner" : config.core == Core::SimplifierCore::IndependentSet ? "-iset" : "";
+    return stage + core + (config.isLazy ? "-lazy" : "");
+}
+
+// every corner its own vertex, as loaders that do not weld hand meshes over.
+static Core::Mesh Unweld(const Core::Mesh& mesh)
+{
+    Core::Mesh soup;
+    for (auto id : mesh.indices) {
+        soup.indices.push_back(soup.vertices.size());
+        soup.vertices.push_back(mesh.vertices[id]);
+    }
+    return soup;
+}
+
+// edge cut and part sizes of one partition, to weigh the time of a strategy against what it produces.
+static void PrintPartitionQuality(const std::string& stage, const std::string& name, const Core::Mesh& mesh, const Core::Graph& graph,
+    Core::PartitionStrategy strategy)
+{
+    const uint32_t minPartSize = Core::Cluster::clusterSize - 4;
+    Core::Partitioner partitioner(strategy);
+    Core::Cluster::PartitionTriangles(mesh.vertices, mesh.indices, graph, partitioner);
+
+    uint32_t minSize = ~0u, maxSize = 0, underNum = 0;
+    for (auto [start, end] : partitioner.GetRanges()) {
+        minSize = std::min(minSize, end - start);
+        maxSize = std::max(maxSize, end - start);
+        underNum += end - start < minPartSize;
+    }
+
+    char line[256];
+    snprintf(line, sizeof(line), "%-22s %-14s %10llu cut %8zu parts   size %u - %u, %u under %u\n",
+        stage.c_str(), name.c_str(), (unsigned long long)partitioner.GetEdgeCut(graph), partitioner.GetRanges().size(),
+        minSize, maxSize, underNum, minPartSize);
+    std::cout << line;
+}
+
+// one stage on 1 to 64 threads. Speedups need as many hardware threads, beyond them the rows only show the cost of
+// the extra threads.
+static void BenchScaling(Bench::Runner& runner, const std::string& stage, const std::string& name, const char* unit, double count,
+    const std::function<void()>& setup, const std::function<void(Util::Scheduler&)>& func)
+{
+    double singleSeconds = 0;
+    std::string speedups;
+    for (uint32_t threadNum = 1; threadNum <= 64; threadNum *= 2) {
+        Util::Scheduler scheduler(threadNum);
+        runner.Run(stage + "-t" + std::to_string(threadNum), name, unit, count, setup, [&] { func(scheduler); });
+        double seconds = runner.GetResults().back().seconds;
+        if (threadNum == 1)
+            singleSeconds = seconds;
+        char text[32];
+        snprintf(text, sizeof(text), " %u:%.2fx", threadNum, seconds > 0 ? singleSeconds / seconds : 0.0);
+        speedups += text;
+    }
+    char line[512];
+    snprintf(line, sizeof(line), "%-22s %-14s speedup over 1 thread%s (%u hardware threads)\n",
+        stage.c_str(), name.c_str(), speedups.c_str(), std::max(1u, std::thread::hardware_concurrency()));
+    std::cout << line;
+}
+
+// false if a lazy or independent set simplification exceeded the error tolerance.
+// isAllocationFree : cleared if BuildParentClusters allocates more than its parent clusters once its scratch has grown.
+static bool BenchStages(Bench::Runner& runner, const std::string& name, const Core::Mesh& mesh, Util::Scheduler& scheduler, bool& isAllocationFree)
+{
+    const double triangleNum = mesh.indices.size() / 3;
+    bool isWithinTolerance = true;
+
+    Core::Mesh work;
+    const Core::Mesh soup = Unweld(mesh);
+    float eagerMaxError = 0;
+    uint32_t eagerEvaluateNum = 0;
+    for (const auto& config : simplifierConfigs) {
+        float maxError = 0;
+        uint32_t evaluateNum = 0;
+        runner.Run(SimplifierStage("simplify-50%", config), name, "tris", triangleNum, [&] { work = mesh; }, [&] {
+            Core::MeshSimplifier meshSimplifier(work.vertices.data(), work.vertices.size(), work.indices.data(), work.indices.size(), config);
+            meshSimplifier.Simplify(work.indices.size() / 6);
+            work.vertices.resize(meshSimplifier.RemainingVertNum());
+            work.indices.resize(meshSimplifier.RemainingTriangleNum() * 3);
+            maxError = meshSimplifier.MaxError();
+            evaluateNum = meshSimplifier.EvaluateNum();
+        });
+
+        char line[256];
+        int length = snprintf(line, sizeof(line), "%-22s %-14s %10zu tris %8zu verts   max error %g, %u evaluates",
+            SimplifierStage("simplify-50%", config).c_str(), name.c_str(), work.indices.size() / 3, work.vertices.size(), maxError, evaluateNum);
+        bool isSerialEager = !config.isLazy && config.core != Core::SimplifierCore::IndependentSet;
+        if (isSerialEager) {
+            eagerMaxError = maxError;
+            eagerEvaluateNum = evaluateNum;
+        } else {
+            float errorChange = eagerMaxError > 0 ? maxError / eagerMaxError - 1 : 0.f;
+            isWithinTolerance = isWithinTolerance && errorChange <= errorTolerance;
+            snprintf(line + length, sizeof(line) - length, " (%+.1f%%), max error %+.1f%% vs eager, tolerance %.0f%%%s",
+                (double(evaluateNum) / std::max(1u, eagerEvaluateNum) - 1) * 100, errorChange * 100, errorTolerance * 100,
+                errorChange > errorTolerance ? "  EXCEEDED" : "");
+        }
+        std::cout << line << "\n";
+
+        if (config.isLazy)
+            continue;
+
+        // quadrics and first costs on the scheduler, the result has to match the serial one exactly.
+        Core::Mesh serial = work;
+        runner.Run(SimplifierStage("simplify-50%-mt", config), name, "tris", triangleNum, [&] { work = mesh; }, [&] {
+            Core::MeshSimplifier meshSimplifier(work.vertices.data(), work.vertices.size(), work.indices.data(), work.indices.size(), config);
+            meshSimplifier.Simplify(work.indices.size() / 6, &scheduler);
+            work.vertices.resize(meshSimplifier.RemainingVertNum());
+            work.indices.resize(meshSimplifier.RemainingTriangleNum() * 3);
+        });
+        if (work.vertices != serial.vertices || work.indices != serial.indices) {
+            std::cout << SimplifierStage("simplify-50%-mt", config) << " " << name << " differs from the serial result\n";
+        }
+
+        runner.Run(SimplifierStage("dedupe", config), name, "tris", triangleNum, [&] { work = soup; }, [&] {
+            Core::MeshSimplifier meshSimplifier(work.vertices.data(), work.vertices.size(), work.indices.data(), work.indices.size(), config);
+            meshSimplifier.Simplify(work.indices.size());
+        });
+
+        if (config.core == Core::SimplifierCore::IndependentSet) {
+            BenchScaling(runner, SimplifierStage("simplify-50%", config), name, "tris", triangleNum, [&] { work = mesh; }, [&](Util::Scheduler& scheduler) {
+                Core::MeshSimplifier meshSimplifier(work.vertices.data(), work.vertices.size(), work.indices.data(), work.indices.size(), config);
+                meshSimplifier.Simplify(work.indices.size() / 6, &scheduler);
+            });
+        }
+    }
+
+    // the weld that replaced the dedupe above, its result has to match the dedupe of the position hash core.
+    Core::Mesh deduped = soup;
+    {
+        Core::MeshSimplifier meshSimplifier(deduped.vertices.data(), deduped.vertices.size(), deduped.indices.data(), deduped.indices.size());
+        meshSimplifier.Simplify(deduped.indices.size());
+        deduped.vertices.resize(meshSimplifier.RemainingVertNum());
+        deduped.indices.resize(meshSimplifier.RemainingTriangleNum() * 3);
+    }
+    runner.Run("weld", name, "tris", triangleNum, [&] { work = soup; }, [&] { Core::WeldMesh(work.vertices, work.indices); });
+    runner.Run("weld-mt", name, "tris", triangleNum, [&] { work = soup; }, [&] { Core::WeldMesh(work.vertices, work.indices, {}, &scheduler); });
+    if (work.vertices != deduped.vertices || work.indices != deduped.indices) {
+        std::cout << "weld " << name << " differs from the dedupe result\n";
+    }
+    BenchScaling(runner, "weld", name, "tris", triangleNum, [&] { work = soup; }, [&](Util::Scheduler& scheduler) {
+        Core::WeldMesh(work.vertices, work.indices, {}, &scheduler);
+    });
+
+    Core::Graph edgeLink;
+    runner.Run("edge-link", name, "tris", triangleNum, [&] { edgeLink = Core::Graph(); }, [&] {
+        Core::Cluster::BuildAdjacentEdgeLink(mesh.vertices, mesh.indices, edgeLink);
+    });
+    BenchScaling(runner, "edge-link", name, "tris", triangleNum, [&] { edgeLink = Core::Graph(); }, [&](Util::Scheduler& scheduler) {
+        Core::Cluster::BuildAdjacentEdgeLink(mesh.vertices, mesh.indices, edgeLink, &scheduler);
+    });
+
+    Core::Graph graph;
+    Core::Cluster::BuildAdjacentGraph(edgeLink, graph);
+    runner.Run("metis-bisection", name, "tris", triangleNum, nullptr, [&] {
+        Core::Partitioner partitioner;
+        partitioner.Partition(graph, Core::Cluster::clusterSize - 4, Core::Cluster::clusterSize);
+    });
+    runner.Run("metis-kway", name, "tris", triangleNum, nullptr, [&] {
+        Core::Partitioner partitioner(Core::PartitionStrategy::KWay);
+        partitioner.Partition(graph, Core::Cluster::clusterSize - 4, Core::Cluster::clusterSize);
+    });
+    runner.Run("spatial-partition", name, "tris", triangleNum, nullptr, [&] {
+        Core::Partitioner partitioner(Core::PartitionStrategy::Spatial);
+        Core::Cluster::PartitionTriangles(mesh.vertices, mesh.indices, graph, partitioner);
+    });
+    PrintPartitionQuality("metis-bisection", name, mesh, graph, Core::PartitionStrategy::Bisection);
+    PrintPartitionQuality("metis-kway", name, mesh, graph, Core::PartitionStrategy::KWay);
+    PrintPartitionQuality("spatial-partition", name, mesh, graph, Core::PartitionStrategy::Spatial);
+
+    std::vector<Core::Cluster> clusters;
+    BenchScaling(runner, "build-clusters", name, "tris", triangleNum, [&] { clusters.clear(); }, [&](Util::Scheduler& scheduler) {
+        Core::Cluster::BuildClusters(mesh.vertices, mesh.indices, clusters, &scheduler);
+    });
+    runner.Run("bounds", name, "tris", triangleNum, nullptr, [&] {
+        for (auto& cluster : clusters) {
+            cluster.sphereBounds = Core::Sphere::FromPoints(cluster.verts.data(), cluster.verts.size());
+            cluster.boxBounds = cluster.verts[0];
+            for (auto v : cluster.verts)
+                cluster.boxBounds = cluster.boxBounds + v;
+        }
+    });
+
+    std::vector<Core::ClusterGroup> groups;
+    Core::ClusterGroup::BuildClusterGroups(clusters, 0, clusters.size(), 0, groups);
+    // the group meshes as BuildParentClusters gathers them, simplified by one reused simplifier.
+    std::vector<Core::Mesh> groupMeshes(groups.size()), workMeshes;
+    for (uint32_t i = 0; i < groups.size(); i++) {
+        for (uint32_t clusterId : groups[i].clusters) {
+            uint32_t idOffset = groupMeshes[i].vertices.size();
+            groupMeshes[i].vertices.insert(groupMeshes[i].vertices.end(), clusters[clusterId].verts.begin(), clusters[clusterId].verts.end());
+            for (auto id : clusters[clusterId].indices)
+                groupMeshes[i].indices.push_back(id + idOffset);
+        }
+    }
+    for (const auto& config : simplifierConfigs) {
+        Core::MeshSimplifier groupSimplifier;
+        auto simplifyGroups = [&] {
+            for (auto& group : workMeshes) {
+                groupSimplifier.Reset(group.vertices.data(), group.vertices.size(), group.indices.data(), group.indices.size(), config);
+                groupSimplifier.Simplify(group.indices.size() / 6);
+            }
+        };
+        workMeshes = groupMeshes;
+        simplifyGroups(); // grows the buffers, the timed runs are the steady state
+        runner.Run(SimplifierStage("simplify-groups", config), name, "groups", groups.size(), [&] { workMeshes = groupMeshes; }, simplifyGroups);
+    }
+
+    std::vector<Core::Cluster> parentClusters;
+    Core::ParentClusterScratch scratch; // reused over the groups like the scratch of one build thread
+    runner.Run("parent-clusters", name, "groups", groups.size(), nullptr, [&] {
+        for (auto& group : groups) {
+            parentClusters.clear();
+            Core::ClusterGroup::BuildParentClusters(group, clusters, parentClusters, {}, {}, nullptr, &scratch);
+        }
+    });
+    // the scratch has grown over all the groups above, now each group may only allocate the buffers of its parents.
+    uint64_t parentBufferNum = 0;
+    const uint64_t allocationCount = Bench::allocationCount;
+    for (auto& group : groups) {
+        parentClusters.clear();
+        Core::ClusterGroup::BuildParentClusters(group, clusters, parentClusters, {}, {}, nullptr, &scratch);
+        for (const auto& cluster : parentClusters)
+            parentBufferNum += !cluster.verts.empty() + !cluster.indices.empty() + !cluster.externalEdges.empty();
+    }
+    const uint64_t scratchAllocationNum = Bench::allocationCount - allocationCount - parentBufferNum;
+    isAllocationFree = isAllocationFree && scratchAllocationNum == 0;
+    {
+        char line[256];
+        snprintf(line, sizeof(line), "%-22s %-14s %10llu allocs besides %llu parent cluster buffers%s\n", "parent-clusters-steady", name.c_str(),
+            (unsigned long long)scratchAllocationNum, (unsigned long long)parentBufferNum, scratchAllocationNum ? "  EXCEEDED" : "");
+        std::cout << line;
+    }
+
+    Core::Mesh buildMesh = mesh;
+    Core::VirtualMesh vmesh;
+    {
+        std::streambuf* coutBuffer = std::cout.rdbuf(nullptr); // the build is chatty
+        vmesh.Build(buildMesh);
+        std::cout.rdbuf(coutBuffer);
+    }
+    // what BuildConfig::buildBytesPerTriangle estimates, the stage peaks include the input mesh.
+    uint64_t buildPeak = 0;
+    for (const auto& stage : vmesh.GetStageMemory())
+        buildPeak = std::max(buildPeak, stage.peak.total);
+    char line[256];
+    snprintf(line, sizeof(line), "%-22s %-14s %10.0f bytes/tri peak, estimated %llu\n", "build-memory", name.c_str(), double(buildPeak) / triangleNum,
+        (unsigned long long)Core::BuildConfig().buildBytesPerTriangle);
+    std::cout << line;
+
+    const std::string packedName = (std::filesystem::temp_directory_path() / "bench_packing.obj").string();
+    std::vector<uint32_t> packedData;
+    runner.Run("packing", name, "tris", triangleNum, [&] { packedData.clear(); }, [&] {
+        std::streambuf* coutBuffer = std::cout.rdbuf(nullptr);
+        Core::Encode::PackingMeshData(packedName, vmesh, packedData);
+        std::cout.rdbuf(coutBuffer);
+    });
+    const std::vector<uint32_t> serialData = packedData;
+    BenchScaling(runner, "packing", name, "tris", triangleNum, [&] { packedData.clear(); }, [&](Util::Scheduler& scheduler) {
+        std::streambuf* coutBuffer = std::cout.rdbuf(nullptr);
+        Core::Encode::PackingMeshData(packedName, vmesh, packedData, &scheduler);
+        std::cout.rdbuf(coutBuffer);
+    });
+    if (packedData != serialData) {
+        std::cout << "packing " << name << " differs from the serial result\n";
+    }
+    std::filesystem::remove(packedName.substr(0, packedName.find_last_of('.')) + ".txt");
+    return isWithinTolerance;
+}
+
+// full builds on 1, 4 and all hardware threads must pack into the same words, false if their fingerprints differ.
+static bool CheckDeterminism(const std::string& name, const Core::Mesh& mesh)
+{
+    const uint32_t threadNums[] = { 1, 4, std::max(1u, std::thread::hardware_concurrency()) };
+    std::string fingerprints;
+    bool isSame = true;
+    uint64_t firstFingerprint = 0;
+    for (uint32_t threadNum : threadNums) {
+        Core::Mesh buildMesh = mesh;
+        Core::VirtualMesh vmesh;
+        Core::BuildConfig config;
+        config.threadNum = threadNum;
+        std::streambuf* coutBuffer = std::cout.rdbuf(nullptr);
+        vmesh.Build(buildMesh, config);
+        std::cout.rdbuf(coutBuffer);
+
+        std::vector<uint32_t> packedData;
+        vmesh.Pack(packedData);
+        uint64_t fingerprint = Core::BuildReport::Fingerprint(packedData);
+        if (fingerprints.empty())
+            firstFingerprint = fingerprint;
+        isSame = isSame && fingerprint == firstFingerprint;
+        fingerprints += " " + std::to_string(threadNum) + ":" + Core::BuildReport::FormatFingerprint(fingerprint);
+    }
+    char line[512];
+    snprintf(line, sizeof(line), "%-22s %-14s %s fingerprints over threads%s\n", "determinism", name.c_str(), isSame ? "same" : "DIFFERENT", fingerprints.c_str());
+    std::cout << line;
+    return isSame;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t repeats = 5;
+    uint32_t gridSize = 256;
+    std::string saveFileName, compareFileName;
+    std::vector<std::string> meshFileNames;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--repeats" && i + 1 < argc)
+            repeats = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--grid" && i + 1 < argc)
+            gridSize = std::max(8, std::atoi(argv[++i]));
+        else if (arg == "--save" && i + 1 < argc)
+            saveFileName = argv[++i];
+        else if (arg == "--compare" && i + 1 < argc)
+            compareFileName = argv[++i];
+        else
+            meshFileNames.push_back(arg);
+    }
+    if (meshFileNames.empty())
+        meshFileNames.push_back("../assets/models/sphere2.obj");
+
+    std::vector<std::pair<std::string, Core::Mesh>> meshes;
+    for (const auto& fileName : meshFileNames) {
+        Core::Mesh mesh;
+        if (!mesh.LoadMesh(fileName))
+            return -1;
+        meshes.push_back({ std::filesystem::path(fileName).stem().string(), std::move(mesh) });
+    }
+    meshes.push_back({ "grid" + std::to_string(gridSize / 4), GenerateGrid(gridSize / 4) });
+    meshes.push_back({ "grid" + std::to_string(gridSize), GenerateGrid(gridSize) });
+
+    {
+        std::streambuf* cerrBuffer = std::cerr.rdbuf(nullptr);
+        for (auto& [name, mesh] : meshes)
+            Core::WeldMesh(mesh.vertices, mesh.indices);
+        std::cerr.rdbuf(cerrBuffer);
+    }
+
+    Bench::Runner runner(repeats);
+    Util::Scheduler scheduler;
+    bool isDeterministic = true;
+    bool isWithinTolerance = true;
+    bool isAllocationFree = true;
+    std::streambuf* cerrBuffer = std::cerr.rdbuf(nullptr); // timer logs of the stages
+    for (const auto& [name, mesh] : meshes) {
+        BenchHashTable(runner, name, mesh);
+        BenchHeap(runner, name, mesh.indices.size());
+        BenchQuadrics(runner, name, mesh);
+        isWithinTolerance = BenchStages(runner, name, mesh, scheduler, isAllocationFree) && isWithinTolerance;
+        isDeterministic = CheckDeterminism(name, mesh) && isDeterministic;
+    }
+    std::cerr.rdbuf(cerrBuffer);
+
+    if (!compareFileName.empty() && !runner.CompareBaseline(compareFileName)) {
+        std::cerr << "Error reading baseline " << compareFileName << "\n";
+    }
+    if (!saveFileName.empty() && !runner.SaveBaseline(saveFileName)) {
+        std::cerr << "Error writing baseline " << saveFileName << "\n";
+        return -1;
+    }
+    if (!isDeterministic) {
+        std::cerr << "Error: builds on different thread nums packed different data\n";
+        return -1;
+    }
+    if (!isWithinTolerance) {
+        std::cerr << "Error: a simplification exceeded the max error tolerance of " << errorTolerance * 100 << "% over eager\n";
+        return -1;
+    }
+    if (!isAllocationFree) {
+        std::cerr << "Error: BuildParentClusters allocated more than its parent clusters with a grown scratch\n";
+        return -1;
+    }
+    return 0;
+}
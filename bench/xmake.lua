@@ -0,0 +1,7 @@
+target("bench")
+    add_files("*.cpp")
+    add_deps("virtualMesh", "meshSimplify", "mesh", "util", "encode")
+    add_packages("glm")
+    add_includedirs(".")
+    set_rundir(".")
+target_end()
@@ -1,4 +1,5 @@
 #include "DebugLodApplication.h"
+#include "Encode.h"
 #include <bit>
 #include <sstream>
 #include <vector>
@@ -23,6 +24,11 @@ DebugLodApplication::~DebugLodApplication()
 
 void DebugLodApplication::Run(std::vector<uint32_t>& packedData)
 {
+    // the shaders read the records as PackedLayout lays them out, data of another format would be misread.
+    if (!Core::Encode::IsPackedHeaderValid(packedData)) {
+        throw std::runtime_error("the packed data is not in the current format");
+    }
+
     CreateCamera();
     CreateCommandBuffer();
 
@@ -88,8 +94,8 @@ void DebugLodApplication::CreateInstanceBuffers(std::vector<uint32_t>& packedDat
 
     _clustersNum = packedData[0];
     _groupsNum = packedData[1];
-    _MipLevelNum = packedData[4 + 20 * _clustersNum - 1] + 1;
-    float radius = std::abs(Util::Uint2Float(packedData[packedData[2] + 8 * (_groupsNum - 1) + 7]));
+    _MipLevelNum = packedData[Core::PackedLayout::headerWords + Core::PackedLayout::clusterWords * (_clustersNum - 1) + Core::PackedLayout::clusterMipLevel] + 1;
+    float radius = std::abs(Util::Uint2Float(packedData[packedData[2] + Core::PackedLayout::groupWords * (_groupsNum - 1) + Core::PackedLayout::groupLodBounds + 3]));
     _modelScale = pow(10, -std::floor(std::log10(radius)));
     // std::cout << radius << " " << _modelScale << "\n";
 
@@ -199,6 +205,7 @@ void DebugLodApplication::CreateGraphicsPipeline(uint32_t pushConstantSize, bool
         info.viewHeight = _swapchain->GetExtent().height;
         info.useInstance = true;
         info.shaderName = { "shaders/debugLod.vert", "shaders/debugLod.frag" };
+        info.shaderDefines = Core::Encode::PackedLayoutDefines();
         info.compareOp = VK_COMPARE_OP_GREATER;
         info.pushConstantSize = pushConstantSize;
         info.colorAttachmentFormats = std::vector<VkFormat> { _swapchain->GetImageFormat() };
@@ -2,6 +2,10 @@
 #extension  GL_ARB_separate_shader_objects:enable
 #extension GL_EXT_nonuniform_qualifier : enable
 
+#ifndef PACKED_CLUSTER_WORDS
+#error "compile with Core::Encode::PackedLayoutDefines(), the cluster records are read as PackedLayout lays them out"
+#endif
+
 layout(location = 0) out vec3 color;
 
 //layout(location = 1) out vec3 coord;
@@ -59,15 +63,15 @@ FrameContext GetFrameContext(){
 Cluster GetCluster(uint clusterId){
 	Cluster cluster;
 	uint idx = 1 + 3 * GetImageNum();
-    uint offset = 4 + 20 * clusterId;
+    uint offset = PACKED_HEADER_WORDS + PACKED_CLUSTER_WORDS * clusterId;
 
-	cluster.verticesNum         = inputData[idx].data[offset + 0];
-    cluster.vertOffset          = inputData[idx].data[offset + 1];
-	cluster.triangleNum         = inputData[idx].data[offset + 2];
-    cluster.indexOffset         = inputData[idx].data[offset + 3];
+	cluster.verticesNum         = inputData[idx].data[offset + PACKED_CLUSTER_VERTEX_NUM];
+    cluster.vertOffset          = inputData[idx].data[offset + PACKED_CLUSTER_VERTEX_OFFSET];
+	cluster.triangleNum         = inputData[idx].data[offset + PACKED_CLUSTER_TRIANGLE_NUM];
+    cluster.indexOffset         = inputData[idx].data[offset + PACKED_CLUSTER_TRIANGLE_OFFSET];
 
-	cluster.groupId             = inputData[idx].data[offset + 18];
-	cluster.mipLevel            = inputData[idx].data[offset + 19];
+	cluster.groupId             = inputData[idx].data[offset + PACKED_CLUSTER_GROUP_ID];
+	cluster.mipLevel            = inputData[idx].data[offset + PACKED_CLUSTER_MIP_LEVEL];
 
 	return cluster;
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Bound.h"
+#include "BuildReport.h"
 #include "Util.h"
 #include "VirtualMesh.h"
 #include <co/fs.h>
@@ -8,96 +9,18 @@
 #include <stdint.h>
 #include <string>
 #include <timer.h>
+#include <utility>
 #include <vector>
 
 namespace Core {
 class Encode final {
 public:
-    static void PackingMeshData(const std::string& modelFileName, const VirtualMesh& vmesh, std::vector<uint32_t>& packedData)
+    static void PackingMeshData(const std::string& modelFileName, const VirtualMesh& vmesh, std::vector<uint32_t>& packedData,
+        Util::Scheduler* scheduler = nullptr)
     {
         Util::Timer timer;
-
-        packedData.push_back(vmesh.GetClusters().size());           // clusters num
-        packedData.push_back(vmesh.GetClusterGroups().size());      // groups num
-        packedData.push_back(0);                                    // group data offset
-        packedData.push_back(0);
-
-        for (auto& cluster : vmesh.GetClusters()) {
-            packedData.push_back(cluster.verts.size());         // vertex nums
-            packedData.push_back(0);                            // vertex data offset
-            packedData.push_back(cluster.indices.size() / 3);   // triangle nums
-            packedData.push_back(0);                            // vertex id data offset
-
-            packedData.push_back(Util::Float2Uint(cluster.sphereBounds.center.x));
-            packedData.push_back(Util::Float2Uint(cluster.sphereBounds.center.y));
-            packedData.push_back(Util::Float2Uint(cluster.sphereBounds.center.z));
-            packedData.push_back(Util::Float2Uint(cluster.sphereBounds.radius));
-
-            packedData.push_back(Util::Float2Uint(cluster.lodBounds.center.x));
-            packedData.push_back(Util::Float2Uint(cluster.lodBounds.center.y));
-            packedData.push_back(Util::Float2Uint(cluster.lodBounds.center.z));
-            packedData.push_back(Util::Float2Uint(cluster.lodBounds.radius));
-
-            Sphere parentLodBounds = vmesh.GetClusterGroups()[cluster.groupId].lodBounds;
-            float maxParentLodError = vmesh.GetClusterGroups()[cluster.groupId].maxParentLodError;
-
-            packedData.push_back(Util::Float2Uint(parentLodBounds.center.x));
-            packedData.push_back(Util::Float2Uint(parentLodBounds.center.y));
-            packedData.push_back(Util::Float2Uint(parentLodBounds.center.z));
-            packedData.push_back(Util::Float2Uint(parentLodBounds.radius));
-
-            packedData.push_back(Util::Float2Uint(cluster.lodError));
-            packedData.push_back(Util::Float2Uint(maxParentLodError));
-            packedData.push_back(cluster.groupId);
-            packedData.push_back(cluster.mipLevel);
-        }
-
-        packedData[2] = packedData.size();
-        for (auto& group : vmesh.GetClusterGroups()) {
-            packedData.push_back(group.clusters.size());    // group cluster num
-            packedData.push_back(0);                        // group cluster offset
-            packedData.push_back(Util::Float2Uint(group.maxParentLodError));
-            packedData.push_back(0);
-
-            packedData.push_back(Util::Float2Uint(group.lodBounds.center.x));
-            packedData.push_back(Util::Float2Uint(group.lodBounds.center.y));
-            packedData.push_back(Util::Float2Uint(group.lodBounds.center.z));
-            packedData.push_back(Util::Float2Uint(group.lodBounds.radius));
-        }
-
-        auto i = 0;
-        for (auto& cluster : vmesh.GetClusters()) {
-            auto offset = 4 + 20 * i;
-            packedData[offset + 1] = packedData.size();
-            for (auto& v : cluster.verts) {
-                packedData.push_back(Util::Float2Uint(v.x));
-                packedData.push_back(Util::Float2Uint(v.y));
-                packedData.push_back(Util::Float2Uint(v.z));
-            }
-            packedData[offset + 3] = packedData.size();
-            for (auto i = 0; i < cluster.indices.size() / 3; i++) {
-                auto i0 = cluster.indices[i * 3 + 0];
-                auto i1 = cluster.indices[i * 3 + 1];
-                auto i2 = cluster.indices[i * 3 + 2];
-                assert(i0 < 256 && i1 < 256 && i2 < 256);
-
-                auto triCornersId = (i0 | (i1 << 8) | (i2 << 16));
-                packedData.push_back(triCornersId);
-            }
-            i++;
-        }
-
-        i = 0;
-        for (auto& group : vmesh.GetClusterGroups()) {
-            uint32_t offset = packedData[2] + 8 * i;
-            packedData[offset + 1] = packedData.size();
-            for (auto clusterId : group.clusters) {
-                packedData.push_back(clusterId);
-            }
-            i++;
-        }
-
-        std::cout << "size: " << packedData.size() * 4 << " bytes\n";
+        vmesh.Pack(packedData, scheduler);
+        std::cout << "size: " << packedData.size() * 4 << " bytes, fingerprint: " << BuildReport::FormatFingerprint(BuildReport::Fingerprint(packedData)) << "\n";
         timer.log("Success pack mesh data");
 
         timer.reset();
@@ -117,10 +40,126 @@ public:
 
         Util::Timer timer;
         std::cout << "Loading packed mesh data ...\n";
-        file.read(packedData.data(), file.size());
+        file.read(packedData.data(), packedData.size() * sizeof(uint32_t));
+        if (!IsPackedHeaderValid(packedData)) {
+            std::cerr << packedFileName << " is not packed in the current format, rebuilding it\n";
+            packedData.clear();
+            return false;
+        }
         timer.log("Success load packed mesh data");
-        std::cerr << "Cluster nums : " << packedData[0] << "\nGroup nums : " << packedData[1] << "\nMipLevel nums : "<< packedData[4 + 20 * packedData[0] - 1] + 1 << "\n\n";
+        const uint32_t clusterNum = packedData[0];
+        const uint32_t mipLevelNum = clusterNum ? packedData[PackedLayout::headerWords + PackedLayout::clusterWords * (clusterNum - 1) + PackedLayout::clusterMipLevel] + 1 : 0;
+        std::cerr << "Cluster nums : " << clusterNum << "\nGroup nums : " << packedData[1] << "\nMipLevel nums : " << mipLevelNum << "\n\n";
+
+        return true;
+    }
+
+    // the packed layout as shader macros, so the shaders reading the records are compiled against PackedLayout
+    // instead of their own copy of the offsets.
+    static std::vector<std::pair<std::string, std::string>> PackedLayoutDefines()
+    {
+        auto define = [](const char* name, uint32_t value) { return std::make_pair(std::string(name), std::to_string(value) + "u"); };
+        return {
+            define("PACKED_FORMAT", PackedLayout::format),
+            define("PACKED_HEADER_WORDS", PackedLayout::headerWords),
+            define("PACKED_CLUSTER_WORDS", PackedLayout::clusterWords),
+            define("PACKED_GROUP_WORDS", PackedLayout::groupWords),
+            define("PACKED_CLUSTER_VERTEX_NUM", PackedLayout::clusterVertexNum),
+            define("PACKED_CLUSTER_VERTEX_OFFSET", PackedLayout::clusterVertexOffset),
+            define("PACKED_CLUSTER_TRIANGLE_NUM", PackedLayout::clusterTriangleNum),
+            define("PACKED_CLUSTER_TRIANGLE_OFFSET", PackedLayout::clusterTriangleOffset),
+            define("PACKED_CLUSTER_SPHERE_BOUNDS", PackedLayout::clusterSphereBounds),
+            define("PACKED_CLUSTER_LOD_BOUNDS", PackedLayout::clusterLodBounds),
+            define("PACKED_CLUSTER_PARENT_LOD_BOUNDS", PackedLayout::clusterParentLodBounds),
+            define("PACKED_CLUSTER_LOD_ERROR", PackedLayout::clusterLodError),
+            define("PACKED_CLUSTER_MAX_PARENT_LOD_ERROR", PackedLayout::clusterMaxParentLodError),
+            define("PACKED_CLUSTER_GROUP_ID", PackedLayout::clusterGroupId),
+            define("PACKED_CLUSTER_MIP_LEVEL", PackedLayout::clusterMipLevel),
+            define("PACKED_CLUSTER_CONE_APEX", PackedLayout::clusterConeApex),
+            define("PACKED_CLUSTER_CONE_AXIS", PackedLayout::clusterConeAxis),
+            define("PACKED_CLUSTER_BOX_MIN", PackedLayout::clusterBoxMin),
+            define("PACKED_CLUSTER_BOX_MAX", PackedLayout::clusterBoxMax),
+            define("PACKED_GROUP_CLUSTER_NUM", PackedLayout::groupClusterNum),
+            define("PACKED_GROUP_CLUSTER_OFFSET", PackedLayout::groupClusterOffset),
+            define("PACKED_GROUP_MAX_PARENT_LOD_ERROR", PackedLayout::groupMaxParentLodError),
+            define("PACKED_GROUP_LOD_BOUNDS", PackedLayout::groupLodBounds),
+        };
+    }
+
+    // false if the header is too short or of another format, or its records run past the end of the data.
+    static bool IsPackedHeaderValid(const std::vector<uint32_t>& packedData)
+    {
+        const uint64_t size = packedData.size();
+        if (size < PackedLayout::headerWords || packedData[3] != PackedLayout::format)
+            return false;
+
+        const uint32_t clusterNum = packedData[0];
+        const uint32_t groupNum = packedData[1];
+        const uint32_t groupOffset = packedData[2];
+        return PackedLayout::headerWords + uint64_t(PackedLayout::clusterWords) * clusterNum <= groupOffset
+            && groupOffset + uint64_t(PackedLayout::groupWords) * groupNum <= size;
+    }
+
+    // rebuild the DAG statistics from packed data, false if the data is not a valid packed mesh.
+    static bool InspectPackedData(const std::vector<uint32_t>& packedData, BuildReport& report)
+    {
+        if (!IsPackedHeaderValid(packedData))
+            return false;
+
+        const uint64_t size = packedData.size();
+        const uint32_t clusterNum = packedData[0];
+        const uint32_t groupNum = packedData[1];
+        const uint32_t groupOffset = packedData[2];
+
+        std::vector<BuildReport::ClusterSummary> clusters(clusterNum);
+        for (uint32_t i = 0; i < clusterNum; i++) {
+            const uint32_t* record = &packedData[PackedLayout::headerWords + PackedLayout::clusterWords * i];
+            auto& cluster = clusters[i];
+            cluster.vertexNum = record[PackedLayout::clusterVertexNum];
+            cluster.triangleNum = record[PackedLayout::clusterTriangleNum];
+            cluster.sphereRadius = Util::Uint2Float(record[PackedLayout::clusterSphereBounds + 3]);
+            cluster.lodError = Util::Uint2Float(record[PackedLayout::clusterLodError]);
+            cluster.mipLevel = record[PackedLayout::clusterMipLevel];
+
+            const uint32_t vertexOffset = record[PackedLayout::clusterVertexOffset];
+            if (vertexOffset + uint64_t(cluster.vertexNum) * 3 > size
+                || record[PackedLayout::clusterTriangleOffset] + uint64_t(cluster.triangleNum) > size)
+                return false;
+            for (uint32_t k = 0; k < cluster.vertexNum; k++) {
+                const uint32_t* v = &packedData[vertexOffset + k * 3];
+                cluster.boxBounds = cluster.boxBounds + glm::vec3(Util::Uint2Float(v[0]), Util::Uint2Float(v[1]), Util::Uint2Float(v[2]));
+            }
+        }
+
+        std::vector<BuildReport::GroupSummary> groups(groupNum);
+        for (uint32_t i = 0; i < groupNum; i++) {
+            const uint32_t* record = &packedData[groupOffset + PackedLayout::groupWords * i];
+            auto& group = groups[i];
+            group.clusterNum = record[PackedLayout::groupClusterNum];
+            const uint32_t clusterOffset = record[PackedLayout::groupClusterOffset];
+            if (clusterOffset + uint64_t(group.clusterNum) > size)
+                return false;
+
+            // groups are built from clusters of one level.
+            uint32_t firstCluster = group.clusterNum ? packedData[clusterOffset] : 0;
+            group.mipLevel = firstCluster < clusterNum ? clusters[firstCluster].mipLevel : 0;
+
+            // the group sphere is not packed, bound the spheres of its clusters again.
+            std::vector<Sphere> spheres;
+            for (uint32_t k = 0; k < group.clusterNum; k++) {
+                uint32_t clusterId = packedData[clusterOffset + k];
+                if (clusterId >= clusterNum)
+                    return false;
+                const uint32_t* clusterRecord = &packedData[PackedLayout::headerWords + PackedLayout::clusterWords * clusterId];
+                const uint32_t* bounds = clusterRecord + PackedLayout::clusterSphereBounds;
+                spheres.push_back({ glm::vec3(Util::Uint2Float(bounds[0]), Util::Uint2Float(bounds[1]), Util::Uint2Float(bounds[2])),
+                    Util::Uint2Float(bounds[3]) });
+            }
+            group.sphereRadius = spheres.empty() ? 0.f : Sphere::FromSpheres(spheres, spheres.size()).radius;
+        }
 
+        BuildReport::Collect(clusters, groups, report);
+        report.fingerprint = BuildReport::Fingerprint(packedData);
         return true;
     }
 };
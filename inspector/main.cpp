@@ -0,0 +1,233 @@
+#include "Bound.h"
+#include "BuildReport.h"
+#include "Encode.h"
+#include <cmath>
+#include <co/fs.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct ConeCullingStats {
+    uint32_t viewNum = 0;
+    uint64_t clusterTestNum = 0;        // views * clusters
+    uint64_t culledClusterNum = 0;
+    uint64_t culledVisibleTriangleNum = 0; // front facing triangles of culled clusters, must stay 0
+};
+
+// test the packed normal cones from viewNum points around the mesh against the triangles they bound,
+// false if the data is not a valid packed mesh. Call after InspectPackedData accepted the data.
+static bool CheckConeCulling(const std::vector<uint32_t>& packedData, uint32_t viewNum, ConeCullingStats& stats)
+{
+    const uint32_t clusterNum = packedData.size() >= Core::PackedLayout::headerWords ? packedData[0] : 0;
+    if (clusterNum == 0)
+        return false;
+
+    std::vector<Core::Cone> cones(clusterNum);
+    std::vector<Core::Sphere> spheres(clusterNum);
+    for (uint32_t i = 0; i < clusterNum; i++) {
+        const uint32_t* record = &packedData[Core::PackedLayout::headerWords + Core::PackedLayout::clusterWords * i];
+        spheres[i] = { glm::vec3(Util::Uint2Float(record[4]), Util::Uint2Float(record[5]), Util::Uint2Float(record[6])), Util::Uint2Float(record[7]) };
+        cones[i].apex = glm::vec3(Util::Uint2Float(record[20]), Util::Uint2Float(record[21]), Util::Uint2Float(record[22]));
+        cones[i].cutoff = Util::Uint2Float(record[23]);
+        cones[i].axis = glm::vec3(Util::Uint2Float(record[24]), Util::Uint2Float(record[25]), Util::Uint2Float(record[26]));
+    }
+    Core::Sphere bounds = Core::Sphere::FromSpheres(spheres, spheres.size());
+
+    stats = ConeCullingStats();
+    stats.viewNum = viewNum;
+    const float distanceScales[] = { 0.5f, 1.5f, 4.f };     // inside the mesh bounds too, where the back faces show
+    for (uint32_t view = 0; view < viewNum; view++) {
+        // spread over a sphere along a fibonacci spiral.
+        float z = 1.f - 2.f * (view + 0.5f) / viewNum;
+        float phi = 2.39996323f * view;
+        float r = std::sqrt(1.f - z * z);
+        glm::vec3 viewPoint = bounds.center + glm::vec3(r * std::cos(phi), r * std::sin(phi), z) * bounds.radius * distanceScales[view % 3];
+
+        for (uint32_t i = 0; i < clusterNum; i++) {
+            stats.clusterTestNum++;
+            if (!cones[i].IsBackFacing(viewPoint))
+                continue;
+            stats.culledClusterNum++;
+
+            const uint32_t* record = &packedData[Core::PackedLayout::headerWords + Core::PackedLayout::clusterWords * i];
+            auto position = [&](uint32_t vertId) {
+                const uint32_t* v = &packedData[record[1] + vertId * 3];
+                return glm::vec3(Util::Uint2Float(v[0]), Util::Uint2Float(v[1]), Util::Uint2Float(v[2]));
+            };
+            for (uint32_t k = 0; k < record[2]; k++) {
+                uint32_t triangle = packedData[record[3] + k];
+                glm::vec3 p0 = position(triangle & 255);
+                glm::vec3 normal = glm::cross(position((triangle >> 8) & 255) - p0, position((triangle >> 16) & 255) - p0);
+                glm::vec3 toView = viewPoint - p0;
+                // edge on triangles cover no pixel, allow for the rounding of the packed floats.
+                if (glm::dot(normal, toView) > 1e-4f * glm::length(normal) * glm::length(toView))
+                    stats.culledVisibleTriangleNum++;
+            }
+        }
+    }
+    return true;
+}
+
+struct FrustumCullingStats {
+    uint32_t viewNum = 0;
+    uint64_t clusterTestNum = 0;        // views * clusters
+    uint64_t sphereVisibleNum = 0;      // clusters the sphere keeps
+    uint64_t boxVisibleNum = 0;
+    uint64_t boundsVisibleNum = 0;      // kept by sphere and box, what the culling shader draws
+    uint64_t exactVisibleNum = 0;       // no plane has all the vertices outside
+    uint64_t missedVisibleNum = 0;      // culled by the bounds but not by the vertices, must stay 0
+};
+
+// frustum test of the packed spheres and boxes from viewNum cameras around the mesh, against the vertices they
+// bound; what the bounds keep over the vertices are the false positives. Call after InspectPackedData accepted the data.
+static bool CheckFrustumCulling(const std::vector<uint32_t>& packedData, uint32_t viewNum, FrustumCullingStats& stats)
+{
+    const uint32_t clusterNum = packedData.size() >= Core::PackedLayout::headerWords ? packedData[0] : 0;
+    if (clusterNum == 0)
+        return false;
+
+    std::vector<Core::Sphere> spheres(clusterNum);
+    std::vector<Core::Bounds> boxes(clusterNum);
+    for (uint32_t i = 0; i < clusterNum; i++) {
+        const uint32_t* record = &packedData[Core::PackedLayout::headerWords + Core::PackedLayout::clusterWords * i];
+        spheres[i] = { glm::vec3(Util::Uint2Float(record[4]), Util::Uint2Float(record[5]), Util::Uint2Float(record[6])), Util::Uint2Float(record[7]) };
+        boxes[i].pMin = glm::vec3(Util::Uint2Float(record[28]), Util::Uint2Float(record[29]), Util::Uint2Float(record[30]));
+        boxes[i].pMax = glm::vec3(Util::Uint2Float(record[32]), Util::Uint2Float(record[33]), Util::Uint2Float(record[34]));
+    }
+    // the cameras are placed on the boxes, they bound the vertices however the spheres are built.
+    Core::Bounds meshBox;
+    for (auto& box : boxes)
+        meshBox = meshBox + box;
+    Core::Sphere bounds = { (meshBox.pMin + meshBox.pMax) * 0.5f, glm::length(meshBox.pMax - meshBox.pMin) * 0.5f };
+
+    auto fibonacciDirection = [](uint32_t i, uint32_t n) {
+        float z = 1.f - 2.f * (i + 0.5f) / n;
+        float phi = 2.39996323f * i;
+        float r = std::sqrt(1.f - z * z);
+        return glm::vec3(r * std::cos(phi), r * std::sin(phi), z);
+    };
+
+    stats = FrustumCullingStats();
+    stats.viewNum = viewNum;
+    const float distanceScales[] = { 1.2f, 2.f, 4.f };
+    const float tanHalfFov = 0.3f;     // narrow, so the frustum sides cut through the mesh
+    for (uint32_t view = 0; view < viewNum; view++) {
+        glm::vec3 eye = bounds.center + fibonacciDirection(view, viewNum) * bounds.radius * distanceScales[view % 3];
+        glm::vec3 target = bounds.center + fibonacciDirection((view * 7 + 3) % viewNum, viewNum) * bounds.radius * 0.5f;
+        glm::vec3 forward = glm::normalize(target - eye);
+        glm::vec3 right = glm::cross(forward, std::abs(forward.y) < 0.9f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0));
+        right = glm::normalize(right);
+        glm::vec3 up = glm::cross(right, forward);
+
+        // inward normals, a point p is inside when dot(normal, p) + d >= 0 for all planes.
+        glm::vec3 normals[5] = { glm::normalize(forward * tanHalfFov + right), glm::normalize(forward * tanHalfFov - right),
+            glm::normalize(forward * tanHalfFov + up), glm::normalize(forward * tanHalfFov - up), forward };
+        float d[5];
+        for (uint32_t k = 0; k < 5; k++)
+            d[k] = -glm::dot(normals[k], eye);
+        d[4] -= bounds.radius * 0.01f;     // near plane
+
+        for (uint32_t i = 0; i < clusterNum; i++) {
+            stats.clusterTestNum++;
+            const uint32_t* record = &packedData[Core::PackedLayout::headerWords + Core::PackedLayout::clusterWords * i];
+            glm::vec3 boxCenter = (boxes[i].pMin + boxes[i].pMax) * 0.5f;
+            glm::vec3 boxExtent = (boxes[i].pMax - boxes[i].pMin) * 0.5f;
+
+            bool isSphereVisible = true, isBoxVisible = true, isExactVisible = true;
+            for (uint32_t k = 0; k < 5; k++) {
+                isSphereVisible = isSphereVisible && glm::dot(normals[k], spheres[i].center) + d[k] >= -spheres[i].radius;
+                isBoxVisible = isBoxVisible && glm::dot(normals[k], boxCenter) + d[k] >= -glm::dot(glm::abs(normals[k]), boxExtent);
+
+                bool isAllOutside = true;
+                for (uint32_t v = 0; v < record[0] && isAllOutside; v++) {
+                    const uint32_t* p = &packedData[record[1] + v * 3];
+                    isAllOutside = glm::dot(normals[k], glm::vec3(Util::Uint2Float(p[0]), Util::Uint2Float(p[1]), Util::Uint2Float(p[2]))) + d[k] < 0;
+                }
+                isExactVisible = isExactVisible && !isAllOutside;
+            }
+            stats.sphereVisibleNum += isSphereVisible;
+            stats.boxVisibleNum += isBoxVisible;
+            stats.boundsVisibleNum += isSphereVisible && isBoxVisible;
+            stats.exactVisibleNum += isExactVisible;
+            stats.missedVisibleNum += isExactVisible && !(isSphereVisible && isBoxVisible);
+        }
+    }
+    return true;
+}
+
+// Usage: inspector <packed mesh .txt> [report .json] [--cones] [--frustum]
+// Prints the DAG statistics of a packed mesh as JSON, to stdout when no report file is given.
+// --cones also checks the cone culling of the clusters from views around the mesh, fails if it drops a visible triangle.
+// --frustum counts the false positives of frustum culling by sphere, box and both, fails if the bounds drop a visible cluster.
+int main(int argc, char** argv)
+{
+    std::vector<std::string> fileNames;
+    bool isCheckingCones = false;
+    bool isCheckingFrustum = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--cones")
+            isCheckingCones = true;
+        else if (std::string(argv[i]) == "--frustum")
+            isCheckingFrustum = true;
+        else
+            fileNames.push_back(argv[i]);
+    }
+    if (fileNames.empty()) {
+        std::cerr << "Usage: inspector <packed mesh file> [report json file] [--cones] [--frustum]\n";
+        return -1;
+    }
+
+    const std::string packedFileName = fileNames[0];
+    fs::file file(packedFileName.c_str(), 'r');
+    if (!file) {
+        std::cerr << "Error opening packed mesh: " << packedFileName << "\n";
+        return -1;
+    }
+    std::vector<uint32_t> packedData(file.size() / sizeof(uint32_t));
+    file.read(packedData.data(), packedData.size() * sizeof(uint32_t));
+
+    Core::BuildReport report;
+    if (!Core::Encode::InspectPackedData(packedData, report)) {
+        std::cerr << "Error: " << packedFileName << " is not a valid packed mesh of the current format, rebuild it\n";
+        return -1;
+    }
+    if (report.sections.totalBytes != packedData.size() * sizeof(uint32_t)) {
+        std::cerr << "Warning: sections add up to " << report.sections.totalBytes << " bytes, file has " << packedData.size() * sizeof(uint32_t) << "\n";
+    }
+
+    if (fileNames.size() < 2) {
+        std::cout << report.ToJson();
+    } else if (!report.WriteJson(fileNames[1])) {
+        std::cerr << "Error writing report to " << fileNames[1] << "\n";
+        return -1;
+    }
+
+    if (isCheckingCones) {
+        ConeCullingStats stats;
+        if (!CheckConeCulling(packedData, 96, stats)) {
+            std::cerr << "Error: " << packedFileName << " has no clusters\n";
+            return -1;
+        }
+        std::cerr << "Cone culling : " << stats.culledClusterNum << " of " << stats.clusterTestNum << " cluster tests culled ("
+                  << 100.0 * stats.culledClusterNum / stats.clusterTestNum << "%) over " << stats.viewNum << " views, "
+                  << stats.culledVisibleTriangleNum << " visible triangles culled\n";
+        if (stats.culledVisibleTriangleNum)
+            return -1;
+    }
+
+    if (isCheckingFrustum) {
+        FrustumCullingStats stats;
+        if (!CheckFrustumCulling(packedData, 96, stats)) {
+            std::cerr << "Error: " << packedFileName << " has no clusters\n";
+            return -1;
+        }
+        auto falsePositives = [&](uint64_t visibleNum) { return visibleNum - stats.exactVisibleNum; };
+        std::cerr << "Frustum culling : " << stats.exactVisibleNum << " of " << stats.clusterTestNum << " cluster tests visible over "
+                  << stats.viewNum << " views, false positives : sphere " << falsePositives(stats.sphereVisibleNum)
+                  << ", box " << falsePositives(stats.boxVisibleNum) << ", sphere and box " << falsePositives(stats.boundsVisibleNum)
+                  << ", " << stats.missedVisibleNum << " visible clusters culled\n";
+        if (stats.missedVisibleNum)
+            return -1;
+    }
+    return 0;
+}
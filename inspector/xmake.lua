@@ -0,0 +1,5 @@
+target("inspector")
+    add_files("*.cpp")
+    add_deps("virtualMesh", "mesh", "util", "encode")
+    add_packages("glm")
+target_end()
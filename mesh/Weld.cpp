@@ -0,0 +1,100 @@
+#include "Weld.h"
+#include "MemoryTracker.h"
+#include "RadixSort.h"
+#include "Scheduler.h"
+
+#include <bit>
+#include <cmath>
+
+namespace Core {
+	template <typename T>
+	using WeldVector = Util::TrackedVector<T, Util::MemoryTag::Mesh>;
+
+	// equal floats give equal words (-0 and 0 too), with an epsilon the index of the cell.
+	static uint32_t PositionWord(float x, float invEpsilon) {
+		if (invEpsilon > 0) return uint32_t(int32_t(std::floor(x * invEpsilon)));
+		return x == 0.f ? 0u : std::bit_cast<uint32_t>(x);
+	}
+
+	static bool IsSameKey(const Util::RadixItem<3>& a, const Util::RadixItem<3>& b) {
+		return a.words[0] == b.words[0] && a.words[1] == b.words[1] && a.words[2] == b.words[2];
+	}
+
+	WeldStats WeldMesh(std::vector<glm::vec3>& vertices, std::vector<uint32_t>& indices, const WeldConfig& config, Util::Scheduler* scheduler) {
+		WeldStats stats;
+		const uint32_t vertNum = vertices.size();
+		const uint32_t triangleNum = indices.size() / 3;
+		const float invEpsilon = config.epsilon > 0 ? 1.f / config.epsilon : 0.f;
+
+		// vertices sorted by position; the sort is stable, so the last of a group has the highest id.
+		WeldVector<Util::RadixItem<3>> items(vertNum), scratch;
+		Util::ForEachChunk(scheduler, vertNum, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				const auto& v = vertices[i];
+				items[i] = { { PositionWord(v.z, invEpsilon), PositionWord(v.y, invEpsilon), PositionWord(v.x, invEpsilon) }, i };
+			}
+		});
+		Util::RadixSort(items, scratch, scheduler);
+
+		WeldVector<uint32_t> remap(vertNum);
+		for (uint32_t end = vertNum; end > 0;) {
+			uint32_t begin = end - 1;
+			while (begin > 0 && IsSameKey(items[begin - 1], items[end - 1])) begin--;
+			for (uint32_t i = begin; i < end; i++) remap[items[i].value] = items[end - 1].value;
+			stats.weldedVertNum += end - begin - 1;
+			end = begin;
+		}
+
+		// triangles keyed by their welded corners, rotated to start at the smallest one so that the same winding
+		// gives the same key. The first triangle of a group stays, unless it is degenerate.
+		WeldVector<uint8_t> isDegenerate(triangleNum);
+		items.resize(triangleNum);
+		Util::ForEachChunk(scheduler, triangleNum, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				uint32_t a = remap[indices[i * 3 + 0]], b = remap[indices[i * 3 + 1]], c = remap[indices[i * 3 + 2]];
+				isDegenerate[i] = a == b || b == c || a == c;
+				if (b < a && b < c) items[i] = { { a, c, b }, i };
+				else if (c < a && c < b) items[i] = { { b, a, c }, i };
+				else items[i] = { { c, b, a }, i };
+			}
+		});
+		Util::RadixSort(items, scratch, scheduler);
+		WeldVector<Util::RadixItem<3>>().swap(scratch);
+
+		WeldVector<uint8_t> isRemoved(isDegenerate.begin(), isDegenerate.end());
+		for (uint32_t begin = 0, end = 0; begin < triangleNum; begin = end) {
+			for (end = begin + 1; end < triangleNum && IsSameKey(items[begin], items[end]); end++) {
+				if (!isDegenerate[items[end].value]) {
+					isRemoved[items[end].value] = 1;
+					stats.duplicateTriangleNum++;
+				}
+			}
+		}
+		WeldVector<Util::RadixItem<3>>().swap(items);
+
+		// the used welded vertices and the kept triangles, both compacted in place in input order.
+		WeldVector<uint32_t> vertexIds(vertNum, ~0u);
+		for (uint32_t i = 0; i < triangleNum; i++) {
+			if (isDegenerate[i]) stats.degenerateTriangleNum++;
+			if (isRemoved[i]) continue;
+			for (uint32_t k = 0; k < 3; k++) vertexIds[remap[indices[i * 3 + k]]] = 0;
+		}
+		uint32_t vertCnt = 0;
+		for (uint32_t i = 0; i < vertNum; i++) {
+			if (vertexIds[i] == ~0u) continue;
+			vertices[vertCnt] = vertices[i];
+			vertexIds[i] = vertCnt++;
+		}
+		stats.unusedVertNum = vertNum - stats.weldedVertNum - vertCnt;
+
+		uint32_t triCnt = 0;
+		for (uint32_t i = 0; i < triangleNum; i++) {
+			if (isRemoved[i]) continue;
+			for (uint32_t k = 0; k < 3; k++) indices[triCnt * 3 + k] = vertexIds[remap[indices[i * 3 + k]]];
+			triCnt++;
+		}
+		vertices.resize(vertCnt);
+		indices.resize(triCnt * 3);
+		return stats;
+	}
+}
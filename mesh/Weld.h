@@ -0,0 +1,28 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace Util {
+	class Scheduler;
+}
+
+namespace Core {
+	struct WeldConfig {
+		float epsilon = 0;		// 0 : only equal positions merge, else positions in the same cell of this size
+	};
+
+	struct WeldStats {
+		uint32_t weldedVertNum = 0;			// merged into another vertex
+		uint32_t unusedVertNum = 0;			// referenced by no triangle
+		uint32_t degenerateTriangleNum = 0;	// two corners on one vertex after welding
+		uint32_t duplicateTriangleNum = 0;	// the same vertices in the same winding as an earlier triangle
+	};
+
+	// merges vertices by a parallel radix sort of their quantized positions, then drops degenerate triangles and
+	// later duplicates of a triangle. A merged vertex keeps the position of the last vertex of its group; the
+	// remaining vertices and triangles stay in input order, so the result is the same for any thread count.
+	WeldStats WeldMesh(std::vector<glm::vec3>& vertices, std::vector<uint32_t>& indices, const WeldConfig& config = {},
+		Util::Scheduler* scheduler = nullptr);
+}
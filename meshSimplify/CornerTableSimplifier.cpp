@@ -0,0 +1,660 @@
+#include "HashTable.h"
+#include "Heap.h"
+#include "SimplifierImpl.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <atomic>
+#include <bit>
+
+namespace Core {
+// the same collapses as the position hash core on integer topology. Positions are welded to one vertex id
+// once in Reset, after that every vertex knows its corners and edges through intrusive lists, so neighbours
+// are found without hashing or comparing positions and a collapse only relinks the lists of its two ends.
+// As the IndependentSet core it collapses rounds of edges whose neighbourhoods do not overlap, concurrently.
+class CornerTableSimplifier final : public MeshSimplifierImpl {
+public:
+    CornerTableSimplifier(SimplifierCore core);
+
+    SimplifierCore GetCore() const override { return core; }
+    void Reset(glm::vec3* vertices, uint32_t vertNum, uint32_t* indices, uint32_t indexNum) override;
+    void LockPosition(const glm::vec3& v) override;
+    void Simplify(uint32_t targetTriangleNum, Util::Scheduler* scheduler) override;
+
+private:
+    // welded vertex ids, v[0] is ~0u once the edge collapsed or merged into another one.
+    struct Edge {
+        uint32_t v[2];
+    };
+
+    const SimplifierCore core;
+    uint32_t vertNum;
+    uint32_t indexNum;
+    uint32_t triangleNum;
+
+    glm::vec3* vertices;
+    uint32_t* indices;
+
+    Util::HashTable vertexHash; // welded vertices by position, only for the weld and LockPosition
+
+    SimplifierVector<uint32_t> vertexRefs; // corners of live triangles on each vertex
+    SimplifierVector<uint8_t> vertexLocks;
+    SimplifierVector<uint32_t> vertexStamps;
+    SimplifierVector<uint32_t> vertexVersions; // lazy mode : the last collapse that changed the triangles around the vertex
+
+    // corners of each vertex, a list through cornerNext. Corners of removed triangles are skipped and dropped lazily.
+    SimplifierVector<uint32_t> cornerHeads;
+    SimplifierVector<uint32_t> cornerNext;
+
+    // edge ends (edge * 2 + side) of each vertex, a list through edgeNext. Dead edges are skipped the same way.
+    SimplifierVector<Edge> edges;
+    SimplifierVector<uint32_t> edgeHeads;
+    SimplifierVector<uint32_t> edgeNext;
+    SimplifierVector<uint32_t> edgeVersions; // lazy mode : the collapse count when the cost in the heap was computed
+    Util::Heap heap;
+    uint32_t collapseNum;
+
+    SimplifierVector<uint8_t> triangleRemoved; // a byte each, concurrent collapses never write the same location
+    QuadricStore<QuadricReal> triQuadrics;
+    SimplifierVector<float> edgeCosts; // first costs, built into the heap at once
+
+    // sets are marked by writing the current stamp, a new set only bumps it.
+    uint32_t stamp;
+
+    SimplifierVector<uint32_t> adjTriangles;
+    SimplifierVector<uint32_t> adjVertices;
+    SimplifierVector<uint32_t> reevaluateEdges;
+
+    // independent set rounds : the edges that may collapse, the lowest key among the edges around each vertex
+    // and the state of each candidate.
+    SimplifierVector<uint32_t> candidates;
+    SimplifierVector<uint64_t> vertexKeys;
+    enum CandidateState : uint8_t {
+        Lost,
+        Won,
+        Dropped
+    };
+    SimplifierVector<uint8_t> candidateWins;
+    SimplifierVector<uint32_t> winners;
+
+    bool IsEdgeAlive(uint32_t edgeId) const { return edges[edgeId].v[0] != ~0u; }
+    bool IsEdgeDirty(uint32_t edgeId) const
+    {
+        const auto& edge = edges[edgeId];
+        return std::max(vertexVersions[edge.v[0]], vertexVersions[edge.v[1]]) > edgeVersions[edgeId];
+    }
+    // cost first, ties by id, so every edge has a unique key.
+    uint64_t EdgeKey(uint32_t edgeId) const { return uint64_t(std::bit_cast<uint32_t>(edgeCosts[edgeId])) << 32 | edgeId; }
+    void KillEdge(uint32_t edgeId);
+    void BuildEdges();
+    void SimplifyIndependentSets(uint32_t targetTriangleNum, Util::Scheduler* scheduler);
+    bool FixupTriangle(uint32_t triangleId);
+    void UpdateQuadric(uint32_t triangleId);
+    bool IsTriangleDuplicate(uint32_t triangleId);
+    float Evaluate(uint32_t edgeId, bool merge);
+    // only reads the mesh, so costs of different edges may run concurrently with their own scratch.
+    float EvaluateCost(uint32_t v0, uint32_t v1, SimplifierVector<uint32_t>& triangles, glm::vec3& v, bool& lock) const;
+    // skip : a vertex whose triangles are gathered already, ~0u : none.
+    void GatherAdjTriangles(uint32_t vertId, uint32_t skip, SimplifierVector<uint32_t>& triangles) const;
+    void Collapse(uint32_t edgeId, uint32_t v0, uint32_t v1, const glm::vec3& v, bool lock);
+    // moves v1 onto v0 and fixes the triangles around them, ring returns the vertices of those triangles. It only
+    // writes the ring, the corners of v0 and v1 and the edges inside the ring, so merges with disjoint rings may run
+    // concurrently. firstStamp and firstStamp + 1 have to be its own.
+    void Merge(uint32_t v0, uint32_t v1, const glm::vec3& v, bool lock, const SimplifierVector<uint32_t>& triangles,
+        SimplifierVector<uint32_t>& ring, uint32_t firstStamp);
+    void Compact();
+};
+
+CornerTableSimplifier::CornerTableSimplifier(SimplifierCore core)
+    : core(core)
+    , vertNum(0)
+    , indexNum(0)
+    , triangleNum(0)
+    , vertices(nullptr)
+    , indices(nullptr)
+    , vertexHash(Util::MemoryTag::Simplifier)
+    , heap(Util::MemoryTag::Simplifier)
+    , collapseNum(0)
+    , stamp(0)
+{
+}
+
+void CornerTableSimplifier::Reset(glm::vec3* vertices, uint32_t vertNum, uint32_t* indices, uint32_t indexNum)
+{
+    this->vertNum = vertNum;
+    this->indexNum = indexNum;
+    this->triangleNum = indexNum / 3;
+    this->vertices = vertices;
+    this->indices = indices;
+
+    maxError = 0;
+    evaluateNum = 0;
+    remainingTriangleNum = triangleNum;
+    stamp = 0;
+    collapseNum = 0;
+
+    vertexHash.Reset(vertNum);
+    vertexRefs.resize(vertNum);
+    vertexLocks.assign(vertNum, 0);
+    vertexStamps.assign(vertNum, 0);
+    vertexVersions.assign(vertNum, 0);
+    cornerHeads.assign(vertNum, ~0u);
+    cornerNext.resize(indexNum);
+    triangleRemoved.assign(triangleNum, 0);
+
+    edges.clear();
+    edgeHeads.clear();
+    edgeNext.clear();
+    edgeVersions.clear();
+    adjTriangles.clear();
+    adjVertices.clear();
+    reevaluateEdges.clear();
+
+    // weld : every vertex maps to the first one at its position (vertexRefs holds the map for now),
+    // the corners are moved onto it and only those first vertices stay in the hash.
+    for (uint32_t i = 0; i < vertNum; i++) {
+        auto hashValue = Util::HashTable::HashValue(vertices[i]);
+        uint32_t weldId = i;
+        for (auto j = vertexHash.First(hashValue); vertexHash.IsValid(j); j = vertexHash.Next(j)) {
+            if (vertices[j] == vertices[i]) {
+                weldId = j;
+                break;
+            }
+        }
+        if (weldId == i)
+            vertexHash.Add(hashValue, i);
+        vertexRefs[i] = weldId;
+    }
+    for (uint32_t corner = 0; corner < indexNum; corner++) {
+        indices[corner] = vertexRefs[indices[corner]];
+    }
+
+    // backwards, so every list starts in corner order.
+    std::fill(vertexRefs.begin(), vertexRefs.end(), 0);
+    for (uint32_t corner = indexNum; corner-- > 0;) {
+        uint32_t vertId = indices[corner];
+        vertexRefs[vertId]++;
+        cornerNext[corner] = cornerHeads[vertId];
+        cornerHeads[vertId] = corner;
+    }
+
+    remainingVertNum = 0;
+    for (uint32_t i = 0; i < vertNum; i++) {
+        remainingVertNum += vertexRefs[i] > 0;
+    }
+}
+
+void CornerTableSimplifier::LockPosition(const glm::vec3& v)
+{
+    auto hashValue = Util::HashTable::HashValue(v);
+    for (auto i = vertexHash.First(hashValue); vertexHash.IsValid(i); i = vertexHash.Next(i)) {
+        if (vertices[i] == v) {
+            vertexLocks[i] = 1;
+            break;
+        }
+    }
+}
+
+void CornerTableSimplifier::Simplify(uint32_t targetTriangleNum, Util::Scheduler* scheduler)
+{
+    for (uint32_t i = 0; i < triangleNum; i++)
+        FixupTriangle(i);
+    // a pure dedupe never needs the quadrics or the edges.
+    if (remainingTriangleNum <= targetTriangleNum) {
+        Compact();
+        return;
+    }
+
+    triQuadrics.Resize(triangleNum);
+    Util::ForEachChunk(scheduler, triangleNum, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            if (!triangleRemoved[i])
+                UpdateQuadric(i);
+        }
+    });
+
+    BuildEdges();
+    edgeVersions.assign(edges.size(), 0);
+    edgeCosts.resize(edges.size());
+    Util::ForEachChunk(scheduler, edges.size(), [&](uint32_t begin, uint32_t end) {
+        SimplifierVector<uint32_t> chunkTriangles;
+        auto& triangles = scheduler ? chunkTriangles : adjTriangles;
+        glm::vec3 v;
+        bool lock;
+        for (uint32_t i = begin; i < end; i++) {
+            edgeCosts[i] = EvaluateCost(edges[i].v[0], edges[i].v[1], triangles, v, lock);
+        }
+    });
+    evaluateNum += edges.size();
+    if (core == SimplifierCore::IndependentSet) {
+        SimplifyIndependentSets(targetTriangleNum, scheduler);
+        Compact();
+        return;
+    }
+    heap.Build(edgeCosts);
+
+    maxError = 0;
+    while (!heap.Empty()) {
+        auto edgeId = heap.Top();
+        if (isLazy && IsEdgeDirty(edgeId)) {
+            heap.Update(Evaluate(edgeId, false), edgeId);
+            continue;
+        }
+        if (heap.GetKey(edgeId) >= 1e6)
+            break;
+
+        heap.Pop();
+        float error = Evaluate(edgeId, true);
+        KillEdge(edgeId); // collapsed, or left without triangles
+        if (error > maxError) {
+            maxError = error;
+        }
+
+        if (remainingTriangleNum <= targetTriangleNum)
+            break;
+        for (auto i : reevaluateEdges) {
+            heap.Add(Evaluate(i, false), i);
+        }
+        reevaluateEdges.clear();
+    }
+    Compact();
+}
+
+void CornerTableSimplifier::SimplifyIndependentSets(uint32_t targetTriangleNum, Util::Scheduler* scheduler)
+{
+    vertexKeys.resize(vertNum);
+    maxError = 0;
+    while (remainingTriangleNum > targetTriangleNum) {
+        // the edges around the last round's collapses, the first round has all costs already.
+        std::atomic<uint32_t> reevaluateNum = 0;
+        Util::ForEachChunk(scheduler, edges.size(), [&](uint32_t begin, uint32_t end) {
+            SimplifierVector<uint32_t> chunkTriangles;
+            auto& triangles = scheduler ? chunkTriangles : adjTriangles;
+            glm::vec3 v;
+            bool lock;
+            uint32_t num = 0;
+            for (uint32_t i = begin; i < end; i++) {
+                if (!IsEdgeAlive(i) || !IsEdgeDirty(i))
+                    continue;
+                edgeCosts[i] = EvaluateCost(edges[i].v[0], edges[i].v[1], triangles, v, lock);
+                edgeVersions[i] = collapseNum;
+                num++;
+            }
+            reevaluateNum += num;
+        });
+        evaluateNum += reevaluateNum;
+
+        // a collapse removes about two triangles, so only the cheapest edges still needed take part;
+        // without the cut a round would collapse expensive edges the serial order never reaches.
+        candidates.clear();
+        for (uint32_t i = 0; i < edges.size(); i++) {
+            if (IsEdgeAlive(i) && edgeCosts[i] < 1e6)
+                candidates.push_back(i);
+        }
+        if (candidates.empty())
+            break;
+        uint32_t neededNum = std::max(1u, (remainingTriangleNum - targetTriangleNum + 1) / 2);
+        if (candidates.size() > neededNum) {
+            std::nth_element(candidates.begin(), candidates.begin() + neededNum - 1, candidates.end(), [&](uint32_t a, uint32_t b) {
+                return EdgeKey(a) < EdgeKey(b);
+            });
+            candidates.resize(neededNum);
+        }
+
+        // a candidate wins when it has the lowest key on every vertex of its neighbourhood, so two winners never share
+        // one and the cheapest candidate always wins; the minimum does not depend on the order of the threads. The
+        // winners collapse and the candidates next to them drop out (their costs are stale now), until none is left.
+        collapseNum++;
+        while (!candidates.empty() && remainingTriangleNum > targetTriangleNum) {
+            candidateWins.assign(candidates.size(), 0);
+            for (auto pass = 0; pass < 3; pass++) {
+                Util::ForEachChunk(scheduler, candidates.size(), [&](uint32_t begin, uint32_t end) {
+                    SimplifierVector<uint32_t> chunkTriangles;
+                    auto& triangles = scheduler ? chunkTriangles : adjTriangles;
+                    for (uint32_t i = begin; i < end; i++) {
+                        uint32_t edgeId = candidates[i];
+                        if (candidateWins[i] == Dropped || !IsEdgeAlive(edgeId)) {
+                            candidateWins[i] = Dropped;
+                            continue;
+                        }
+                        uint32_t v0 = edges[edgeId].v[0], v1 = edges[edgeId].v[1];
+                        uint64_t key = EdgeKey(edgeId);
+                        triangles.clear();
+                        GatherAdjTriangles(v0, ~0u, triangles);
+                        GatherAdjTriangles(v1, v0, triangles);
+
+                        bool isDropped = false, isWinner = true;
+                        auto visit = [&](uint32_t vertId) {
+                            std::atomic_ref<uint64_t> vertexKey(vertexKeys[vertId]);
+                            if (pass == 0) {
+                                isDropped = isDropped || vertexVersions[vertId] == collapseNum;
+                                vertexKey.store(~0ull, std::memory_order_relaxed);
+                            } else if (pass == 1) {
+                                uint64_t minKey = vertexKey.load(std::memory_order_relaxed);
+                                while (key < minKey && !vertexKey.compare_exchange_weak(minKey, key, std::memory_order_relaxed)) {
+                                }
+                            } else {
+                                isWinner = isWinner && vertexKey.load(std::memory_order_relaxed) == key;
+                            }
+                        };
+                        visit(v0);
+                        visit(v1);
+                        for (auto triangleId : triangles) {
+                            for (auto k = 0; k < 3; k++)
+                                visit(indices[triangleId * 3 + k]);
+                        }
+                        if (pass == 0 && isDropped)
+                            candidateWins[i] = Dropped;
+                        if (pass == 2 && isWinner)
+                            candidateWins[i] = Won;
+                    }
+                });
+            }
+
+            winners.clear();
+            uint32_t candidateNum = 0;
+            for (uint32_t i = 0; i < candidates.size(); i++) {
+                if (candidateWins[i] == Won)
+                    winners.push_back(candidates[i]);
+                else if (candidateWins[i] == Lost)
+                    candidates[candidateNum++] = candidates[i];
+            }
+            candidates.resize(candidateNum);
+
+            // the winners touch disjoint neighbourhoods, each gets its own two stamps.
+            uint32_t firstStamp = stamp + 1;
+            stamp += winners.size() * 2;
+            Util::ForEachChunk(scheduler, winners.size(), [&](uint32_t begin, uint32_t end) {
+                SimplifierVector<uint32_t> chunkTriangles, chunkRing;
+                auto& triangles = scheduler ? chunkTriangles : adjTriangles;
+                auto& ring = scheduler ? chunkRing : adjVertices;
+                glm::vec3 v;
+                bool lock;
+                for (uint32_t i = begin; i < end; i++) {
+                    uint32_t edgeId = winners[i];
+                    uint32_t v0 = edges[edgeId].v[0], v1 = edges[edgeId].v[1];
+                    EvaluateCost(v0, v1, triangles, v, lock);
+                    KillEdge(edgeId);
+                    vertexVersions[v0] = vertexVersions[v1] = collapseNum;
+                    if (triangles.empty())
+                        continue;
+                    Merge(v0, v1, v, lock, triangles, ring, firstStamp + i * 2);
+                    for (auto vertId : ring)
+                        vertexVersions[vertId] = collapseNum;
+                }
+            });
+            evaluateNum += winners.size();
+            for (auto edgeId : winners)
+                maxError = std::max(maxError, edgeCosts[edgeId]);
+        }
+    }
+}
+
+void CornerTableSimplifier::KillEdge(uint32_t edgeId)
+{
+    edges[edgeId].v[0] = edges[edgeId].v[1] = ~0u;
+    // independent set rounds keep no heap.
+    if (core != SimplifierCore::IndependentSet && heap.IsPresent(edgeId))
+        heap.Remove(edgeId);
+}
+
+void CornerTableSimplifier::BuildEdges()
+{
+    uint32_t expEdgeNum = std::min(indexNum, triangleNum + vertNum);
+    edges.reserve(expEdgeNum);
+    edgeNext.reserve(expEdgeNum * 2);
+    edgeHeads.assign(vertNum, ~0u);
+
+    // each edge once, from its lower end; the stamp marks the neighbours it already has.
+    for (uint32_t v0 = 0; v0 < vertNum; v0++) {
+        if (vertexRefs[v0] == 0)
+            continue;
+        stamp++;
+        for (auto corner = cornerHeads[v0]; corner != ~0u; corner = cornerNext[corner]) {
+            if (triangleRemoved[corner / 3])
+                continue;
+            for (auto v1 : { indices[Util::Cycle3(corner)], indices[Util::Cycle3(corner, 2)] }) {
+                if (v1 <= v0 || vertexStamps[v1] == stamp)
+                    continue;
+                vertexStamps[v1] = stamp;
+
+                uint32_t edgeId = edges.size();
+                edges.push_back({ { v0, v1 } });
+                edgeNext.push_back(edgeHeads[v0]);
+                edgeHeads[v0] = edgeId * 2;
+                edgeNext.push_back(edgeHeads[v1]);
+                edgeHeads[v1] = edgeId * 2 + 1;
+            }
+        }
+    }
+}
+
+// false : the triangle is degenerate or a duplicate and removed now.
+bool CornerTableSimplifier::FixupTriangle(uint32_t triangleId)
+{
+    assert(!triangleRemoved[triangleId]);
+
+    auto i0 = indices[triangleId * 3 + 0];
+    auto i1 = indices[triangleId * 3 + 1];
+    auto i2 = indices[triangleId * 3 + 2];
+
+    bool isRemoved = (i0 == i1) || (i1 == i2) || (i0 == i2) || IsTriangleDuplicate(triangleId);
+    if (isRemoved) {
+        triangleRemoved[triangleId] = 1;
+        std::atomic_ref<uint32_t>(remainingTriangleNum)--;
+        for (auto k = 0; k < 3; k++) {
+            if (--vertexRefs[indices[triangleId * 3 + k]] == 0)
+                std::atomic_ref<uint32_t>(remainingVertNum)--;
+        }
+    }
+    return !isRemoved;
+}
+
+void CornerTableSimplifier::UpdateQuadric(uint32_t triangleId)
+{
+    triQuadrics.Set(triangleId, vertices[indices[triangleId * 3 + 0]], vertices[indices[triangleId * 3 + 1]], vertices[indices[triangleId * 3 + 2]]);
+}
+
+bool CornerTableSimplifier::IsTriangleDuplicate(uint32_t triangleId)
+{
+    auto i0 = indices[triangleId * 3 + 0];
+    auto i1 = indices[triangleId * 3 + 1];
+    auto i2 = indices[triangleId * 3 + 2];
+    for (auto corner = cornerHeads[i0]; corner != ~0u; corner = cornerNext[corner]) {
+        if (corner / 3 == triangleId || triangleRemoved[corner / 3])
+            continue;
+        if (i1 == indices[Util::Cycle3(corner)] && i2 == indices[Util::Cycle3(corner, 2)])
+            return true;
+    }
+    return false;
+}
+
+float CornerTableSimplifier::Evaluate(uint32_t edgeId, bool merge)
+{
+    uint32_t v0 = edges[edgeId].v[0];
+    uint32_t v1 = edges[edgeId].v[1];
+    assert(v0 != ~0u && v0 != v1);
+
+    evaluateNum++;
+    edgeVersions[edgeId] = collapseNum;
+    glm::vec3 v;
+    bool lock;
+    float error = EvaluateCost(v0, v1, adjTriangles, v, lock);
+
+    if (merge && adjTriangles.size()) {
+        Collapse(edgeId, v0, v1, v, lock);
+    }
+    return error;
+}
+
+float CornerTableSimplifier::EvaluateCost(uint32_t v0, uint32_t v1, SimplifierVector<uint32_t>& triangles, glm::vec3& v, bool& lock) const
+{
+    float error = 0;
+    triangles.clear();
+    GatherAdjTriangles(v0, ~0u, triangles);
+    GatherAdjTriangles(v1, v0, triangles);
+
+    if (!triangles.size())
+        return 0.f;
+    if (triangles.size() > 24) {
+        error += 0.5 * (triangles.size() - 24);
+    }
+
+    auto q = triQuadrics.Accumulate(triangles.data(), triangles.size());
+
+    // the midpoint or a locked end, both always lie inside the edge ellipsoid the position hash core checks.
+    bool lock0 = vertexLocks[v0], lock1 = vertexLocks[v1];
+    lock = lock0 || lock1;
+    v = (vertices[v0] + vertices[v1]) * 0.5f;
+    if (lock0 && lock1)
+        error += 1e8;
+    else if (lock0 && !lock1)
+        v = vertices[v0];
+    else if (!lock0 && lock1)
+        v = vertices[v1];
+
+    error += q.Evaluate(v);
+    return error;
+}
+
+void CornerTableSimplifier::GatherAdjTriangles(uint32_t vertId, uint32_t skip, SimplifierVector<uint32_t>& triangles) const
+{
+    for (auto corner = cornerHeads[vertId]; corner != ~0u; corner = cornerNext[corner]) {
+        auto triangleId = corner / 3;
+        if (triangleRemoved[triangleId])
+            continue;
+        if (indices[Util::Cycle3(corner)] == skip || indices[Util::Cycle3(corner, 2)] == skip)
+            continue;
+        triangles.push_back(triangleId);
+    }
+}
+
+void CornerTableSimplifier::Collapse(uint32_t edgeId, uint32_t v0, uint32_t v1, const glm::vec3& v, bool lock)
+{
+    KillEdge(edgeId);
+    Merge(v0, v1, v, lock, adjTriangles, adjVertices, stamp + 1);
+    stamp += 2;
+
+    // every edge around the collapse changes its cost. Lazily only the edges of v0 are re-evaluated right away,
+    // the others get a new version on their ends and the ones turning dirty a lower key.
+    collapseNum++;
+    for (auto vertId : adjVertices) {
+        if (isLazy && vertId != v0) {
+            for (auto end = edgeHeads[vertId]; end != ~0u; end = edgeNext[end]) {
+                auto i = end / 2;
+                if (IsEdgeAlive(i) && heap.IsPresent(i) && !IsEdgeDirty(i))
+                    heap.Update(heap.GetKey(i) * lazyKeyScale, i);
+            }
+            vertexVersions[vertId] = collapseNum;
+            continue;
+        }
+        for (auto end = edgeHeads[vertId]; end != ~0u; end = edgeNext[end]) {
+            auto i = end / 2;
+            if (IsEdgeAlive(i) && heap.IsPresent(i)) {
+                heap.Remove(i);
+                reevaluateEdges.push_back(i);
+            }
+        }
+    }
+}
+
+void CornerTableSimplifier::Merge(uint32_t v0, uint32_t v1, const glm::vec3& v, bool lock, const SimplifierVector<uint32_t>& triangles,
+    SimplifierVector<uint32_t>& ring, uint32_t firstStamp)
+{
+    vertices[v0] = v;
+    vertexLocks[v0] = lock;
+
+    // v1 merges into v0 : its live corners and edges move over, dead list entries of both are dropped.
+    uint32_t cornerHead = ~0u;
+    for (auto vertId : { v0, v1 }) {
+        for (auto corner = cornerHeads[vertId], next = 0u; corner != ~0u; corner = next) {
+            next = cornerNext[corner];
+            if (triangleRemoved[corner / 3])
+                continue;
+            indices[corner] = v0;
+            cornerNext[corner] = cornerHead;
+            cornerHead = corner;
+        }
+    }
+    cornerHeads[v0] = cornerHead;
+    cornerHeads[v1] = ~0u;
+
+    if (vertexRefs[v0] > 0 && vertexRefs[v1] > 0)
+        std::atomic_ref<uint32_t>(remainingVertNum)--;
+    vertexRefs[v0] += vertexRefs[v1];
+    vertexRefs[v1] = 0;
+
+    // an edge of v1 to a neighbour v0 already has is a duplicate now, the one of v0 is kept.
+    uint32_t edgeHead = ~0u;
+    for (auto vertId : { v0, v1 }) {
+        for (auto end = edgeHeads[vertId], next = 0u; end != ~0u; end = next) {
+            next = edgeNext[end];
+            auto& edge = edges[end / 2];
+            if (!IsEdgeAlive(end / 2))
+                continue;
+            auto other = edge.v[(end & 1) ^ 1];
+            if (other == v0 || vertexStamps[other] == firstStamp) {
+                KillEdge(end / 2);
+                continue;
+            }
+            vertexStamps[other] = firstStamp;
+            edge.v[end & 1] = v0;
+            edgeNext[end] = edgeHead;
+            edgeHead = end;
+        }
+    }
+    edgeHeads[v0] = edgeHead;
+    edgeHeads[v1] = ~0u;
+
+    ring.clear();
+    for (auto i : triangles) {
+        for (auto k = 0; k < 3; k++) {
+            auto vertId = indices[i * 3 + k];
+            if (vertexStamps[vertId] != firstStamp + 1) {
+                vertexStamps[vertId] = firstStamp + 1;
+                ring.push_back(vertId);
+            }
+        }
+    }
+
+    for (auto i : triangles) {
+        if (FixupTriangle(i))
+            UpdateQuadric(i);
+    }
+}
+
+void CornerTableSimplifier::Compact()
+{
+    uint32_t vertCnt = 0;
+    for (uint32_t i = 0; i < vertNum; i++) {
+        if (vertexRefs[i] > 0) {
+            if (i != vertCnt)
+                vertices[vertCnt] = vertices[i];
+            vertexRefs[i] = vertCnt++; // reuse
+        }
+    }
+    assert(vertCnt == remainingVertNum);
+
+    uint32_t triCnt = 0;
+    for (uint32_t i = 0; i < triangleNum; i++) {
+        if (!triangleRemoved[i]) {
+            for (auto k = 0; k < 3; k++) {
+                indices[triCnt * 3 + k] = vertexRefs[indices[i * 3 + k]];
+            }
+            triCnt++;
+        }
+    }
+    assert(triCnt == remainingTriangleNum);
+}
+
+MeshSimplifierImpl* CreateCornerTableSimplifier()
+{
+    return new CornerTableSimplifier(SimplifierCore::CornerTable);
+}
+
+MeshSimplifierImpl* CreateIndependentSetSimplifier()
+{
+    return new CornerTableSimplifier(SimplifierCore::IndependentSet);
+}
+}
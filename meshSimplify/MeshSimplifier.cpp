@@ -2,7 +2,7 @@
 #include "BitArray.h"
 #include "HashTable.h"
 #include "Heap.h"
-#include "Quadric.h"
+#include "SimplifierImpl.h"
 #include "Util.h"
 
 #include <algorithm>
@@ -11,7 +11,20 @@
 
 
 namespace Core {
-class MeshSimplifierImpl : public MeshSimplifier {
+const char* ToString(SimplifierCore core)
+{
+    switch (core) {
+    case SimplifierCore::PositionHash:
+        return "position hash";
+    case SimplifierCore::CornerTable:
+        return "corner table";
+    case SimplifierCore::IndependentSet:
+        return "independent set";
+    }
+    return "unknown";
+}
+
+class PositionHashSimplifier final : public MeshSimplifierImpl {
 public:
     uint32_t vertNum;
     uint32_t indexNum;
@@ -23,72 +36,107 @@ public:
     Util::HashTable vertexHash;
     Util::HashTable cornerHash;
 
-    std::vector<uint32_t> vertexRefs;
-    std::vector<uint8_t> flags;
+    SimplifierVector<uint32_t> vertexRefs;
+    SimplifierVector<uint8_t> flags;
 
     Util::BitArray triangleRemoved;
 
     enum VertexMask {
-        AdjMask = 1,
         LockMask = 2
     };
 
-    std::vector<std::pair<glm::vec3, glm::vec3>> edges;
-    Util::HashTable* edge0Hash;
-    Util::HashTable* edge1Hash;
+    SimplifierVector<std::pair<glm::vec3, glm::vec3>> edges;
+    Util::HashTable edge0Hash;
+    Util::HashTable edge1Hash;
     Util::Heap heap;
+    Util::BitArray edgeDirty; // lazy mode : the key in the heap is stale
+
+    SimplifierVector<uint32_t> moveVertices;
+    SimplifierVector<uint32_t> moveCorners;
+    SimplifierVector<uint32_t> moveEdges;
+    SimplifierVector<uint32_t> reevaluateEdge;
 
-    std::vector<uint32_t> moveVertices;
-    std::vector<uint32_t> moveCorners;
-    std::vector<uint32_t> moveEdges;
-    std::vector<uint32_t> reevaluateEdge;
+    // scratch of Evaluate, an instance runs on one thread at a time so they are per thread.
+    SimplifierVector<uint32_t> adjTriangles;
+    SimplifierVector<uint32_t> adjVertices;
 
-    std::vector<Quadric> triQuadrics;
+    QuadricStore<QuadricReal> triQuadrics;
+    SimplifierVector<float> edgeCosts; // first costs, built into the heap at once
 
-    float maxError;
-    uint32_t remainingVertNum;
-    uint32_t remainingTriangleNum;
+    PositionHashSimplifier();
 
-    MeshSimplifierImpl(glm::vec3* vertices, uint32_t vertNum, uint32_t* indices, uint32_t indexNum);
-    ~MeshSimplifierImpl() { }
+    SimplifierCore GetCore() const override { return SimplifierCore::PositionHash; }
+    void Reset(glm::vec3* vertices, uint32_t vertNum, uint32_t* indices, uint32_t indexNum) override;
+    void LockPosition(const glm::vec3& v) override;
+    void Simplify(uint32_t targetTriangleNum, Util::Scheduler* scheduler) override;
 
     bool AddEdgeHash(glm::vec3& v0, glm::vec3& v1, uint32_t id);
-    void LockPosition(const glm::vec3& v);
-    void Simplify(uint32_t targetTriangleNum);
-    void FixupTriangle(uint32_t triangleId);
+    bool FixupTriangle(uint32_t triangleId);
+    void UpdateQuadric(uint32_t triangleId);
     void RemoveDuplicatedVertex(uint32_t corner);
     void SetVertId(uint32_t corner, uint32_t id);
     bool IsTriangleDuplicate(uint32_t triangleId);
     float Evaluate(const glm::vec3& v0, const glm::vec3& v1, bool merge);
-    void GatherAdjTriangles(const glm::vec3& v, std::vector<uint32_t>& triangles, bool& lock);
+    // only reads the mesh, so costs of different edges may run concurrently with their own scratch.
+    float EvaluateCost(const glm::vec3& v0, const glm::vec3& v1, SimplifierVector<uint32_t>& triangles, glm::vec3& v, bool& lock0, bool& lock1) const;
+    void MarkReevaluate(uint32_t edgeId, bool isMerged);
+    // skip : a position whose triangles are gathered already, nullptr : none.
+    void GatherAdjTriangles(const glm::vec3& v, const glm::vec3* skip, SimplifierVector<uint32_t>& triangles, bool& lock) const;
     void BeginMerge(const glm::vec3& v);
     void EndMerge();
     void Compact();
 };
 
-MeshSimplifierImpl::MeshSimplifierImpl(glm::vec3* vertices, uint32_t vertNum, uint32_t* indices, uint32_t indexNum)
-    : vertNum(vertNum)
-    , indexNum(indexNum)
-    , triangleNum(indexNum / 3)
-    , vertices(vertices)
-    , indices(indices)
-    , vertexHash(vertNum)
-    , vertexRefs(vertNum)
-    , cornerHash(indexNum)
-    , triangleRemoved(triangleNum)
-    , flags(indexNum)
+PositionHashSimplifier::PositionHashSimplifier()
+    : vertNum(0)
+    , indexNum(0)
+    , triangleNum(0)
+    , vertices(nullptr)
+    , indices(nullptr)
+    , vertexHash(Util::MemoryTag::Simplifier)
+    , cornerHash(Util::MemoryTag::Simplifier)
+    , triangleRemoved(Util::MemoryTag::Simplifier)
+    , edge0Hash(Util::MemoryTag::Simplifier)
+    , edge1Hash(Util::MemoryTag::Simplifier)
+    , heap(Util::MemoryTag::Simplifier)
+    , edgeDirty(Util::MemoryTag::Simplifier)
 {
+}
+
+void PositionHashSimplifier::Reset(glm::vec3* vertices, uint32_t vertNum, uint32_t* indices, uint32_t indexNum)
+{
+    this->vertNum = vertNum;
+    this->indexNum = indexNum;
+    this->triangleNum = indexNum / 3;
+    this->vertices = vertices;
+    this->indices = indices;
+
+    maxError = 0;
+    evaluateNum = 0;
     remainingVertNum = vertNum;
     remainingTriangleNum = triangleNum;
 
+    // every container keeps its capacity, a simplifier reused for meshes of similar size stops allocating.
+    vertexHash.Reset(vertNum);
+    vertexRefs.assign(vertNum, 0);
+    cornerHash.Reset(indexNum);
+    triangleRemoved.Reset(triangleNum);
+    flags.assign(indexNum, 0);
+
     for (auto i = 0; i < vertNum; i++) {
         vertexHash.Add(Util::HashTable::HashValue(vertices[i]), i);
     }
 
     uint32_t expEdgeNum = std::min(std::min(indexNum, vertNum * 3 - 6), triangleNum + vertNum);
+    edges.clear();
     edges.reserve(expEdgeNum);
-    edge0Hash = new Util::HashTable(expEdgeNum);
-    edge1Hash = new Util::HashTable(expEdgeNum);
+    edge0Hash.Reset(expEdgeNum);
+    edge1Hash.Reset(expEdgeNum);
+
+    moveVertices.clear();
+    moveCorners.clear();
+    moveEdges.clear();
+    reevaluateEdge.clear();
 
     for (auto corner = 0; corner < indexNum; corner++) {
         uint32_t vertId = indices[corner];
@@ -104,7 +152,7 @@ MeshSimplifierImpl::MeshSimplifierImpl(glm::vec3* vertices, uint32_t vertNum, ui
     }
 }
 
-bool MeshSimplifierImpl::AddEdgeHash(glm::vec3& v0, glm::vec3& v1, uint32_t id)
+bool PositionHashSimplifier::AddEdgeHash(glm::vec3& v0, glm::vec3& v1, uint32_t id)
 {
     uint32_t hash0 = Util::HashTable::HashValue(v0);
     uint32_t hash1 = Util::HashTable::HashValue(v1);
@@ -113,17 +161,17 @@ bool MeshSimplifierImpl::AddEdgeHash(glm::vec3& v0, glm::vec3& v1, uint32_t id)
         std::swap(v0, v1);
     }
 
-    for (auto i = edge0Hash->First(hash0); edge0Hash->IsValid(i); i = edge0Hash->Next(i)) {
+    for (auto i = edge0Hash.First(hash0); edge0Hash.IsValid(i); i = edge0Hash.Next(i)) {
         auto& edge = edges[i];
         if (edge.first == v0 && edge.second == v1)
             return false;
     }
-    edge0Hash->Add(hash0, id);
-    edge1Hash->Add(hash1, id);
+    edge0Hash.Add(hash0, id);
+    edge1Hash.Add(hash1, id);
     return true;
 }
 
-void MeshSimplifierImpl::LockPosition(const glm::vec3& v)
+void PositionHashSimplifier::LockPosition(const glm::vec3& v)
 {
     auto hashValue = Util::HashTable::HashValue(v);
     for (auto i = cornerHash.First(hashValue); cornerHash.IsValid(i); i = cornerHash.Next(i)) {
@@ -133,33 +181,55 @@ void MeshSimplifierImpl::LockPosition(const glm::vec3& v)
     }
 }
 
-void MeshSimplifierImpl::Simplify(uint32_t targetTriangleNum)
+void PositionHashSimplifier::Simplify(uint32_t targetTriangleNum, Util::Scheduler* scheduler)
 {
-    triQuadrics.resize(triangleNum);
     for (auto i = 0; i < triangleNum; i++)
         FixupTriangle(i);
+    // a pure dedupe never needs the quadrics.
     if (remainingTriangleNum <= targetTriangleNum) {
         Compact();
         return;
     }
-    heap.Resize(edges.size());
-    uint32_t i = 0;
-    for (auto& edge : edges) {
-        float error = Evaluate(edge.first, edge.second, false);
-        heap.Add(error, i);
-        i++;
+
+    triQuadrics.Resize(triangleNum);
+    Util::ForEachChunk(scheduler, triangleNum, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            if (!triangleRemoved[i])
+                UpdateQuadric(i);
+        }
+    });
+
+    edgeCosts.resize(edges.size());
+    Util::ForEachChunk(scheduler, edges.size(), [&](uint32_t begin, uint32_t end) {
+        SimplifierVector<uint32_t> chunkTriangles;
+        auto& triangles = scheduler ? chunkTriangles : adjTriangles;
+        glm::vec3 v;
+        bool lock0, lock1;
+        for (uint32_t i = begin; i < end; i++) {
+            edgeCosts[i] = EvaluateCost(edges[i].first, edges[i].second, triangles, v, lock0, lock1);
+        }
+    });
+    for (const auto& edge : edges) {
+        evaluateNum += edge.first != edge.second;
     }
+    heap.Build(edgeCosts);
+    edgeDirty.Reset(edges.size());
 
     maxError = 0;
     while (!heap.Empty()) {
         auto edgeId = heap.Top();
+        auto& edge = edges[edgeId];
+        if (edgeDirty[edgeId]) {
+            edgeDirty.SetFalse(edgeId);
+            heap.Update(Evaluate(edge.first, edge.second, false), edgeId);
+            continue;
+        }
         if (heap.GetKey(edgeId) >= 1e6)
             break;
 
         heap.Pop();
-        auto& edge = edges[edgeId];
-        edge0Hash->Remove(Util::HashTable::HashValue(edge.first), edgeId);
-        edge1Hash->Remove(Util::HashTable::HashValue(edge.second), edgeId);
+        edge0Hash.Remove(Util::HashTable::HashValue(edge.first), edgeId);
+        edge1Hash.Remove(Util::HashTable::HashValue(edge.second), edgeId);
 
         float error = Evaluate(edge.first, edge.second, true);
 
@@ -179,7 +249,8 @@ void MeshSimplifierImpl::Simplify(uint32_t targetTriangleNum)
     Compact();
 }
 
-void MeshSimplifierImpl::FixupTriangle(uint32_t triangleId)
+// false : the triangle is degenerate or a duplicate and removed now.
+bool PositionHashSimplifier::FixupTriangle(uint32_t triangleId)
 {
     assert(!triangleRemoved[triangleId]);
 
@@ -207,13 +278,16 @@ void MeshSimplifierImpl::FixupTriangle(uint32_t triangleId)
             cornerHash.Remove(hashValue, corner);
             SetVertId(corner, ~0u);
         }
-
-    } else {
-        triQuadrics[triangleId] = Quadric(v0, v1, v2);
     }
+    return !isRemoved;
+}
+
+void PositionHashSimplifier::UpdateQuadric(uint32_t triangleId)
+{
+    triQuadrics.Set(triangleId, vertices[indices[triangleId * 3 + 0]], vertices[indices[triangleId * 3 + 1]], vertices[indices[triangleId * 3 + 2]]);
 }
 
-void MeshSimplifierImpl::RemoveDuplicatedVertex(uint32_t corner)
+void PositionHashSimplifier::RemoveDuplicatedVertex(uint32_t corner)
 {
     auto vertId = indices[corner];
     auto& v = vertices[vertId];
@@ -228,7 +302,7 @@ void MeshSimplifierImpl::RemoveDuplicatedVertex(uint32_t corner)
     }
 }
 
-void MeshSimplifierImpl::SetVertId(uint32_t corner, uint32_t id)
+void PositionHashSimplifier::SetVertId(uint32_t corner, uint32_t id)
 {
     auto& vertId = indices[corner];
     assert(vertId != ~0u);
@@ -246,7 +320,7 @@ void MeshSimplifierImpl::SetVertId(uint32_t corner, uint32_t id)
         vertexRefs[vertId]++;
 }
 
-bool MeshSimplifierImpl::IsTriangleDuplicate(uint32_t triangleId)
+bool PositionHashSimplifier::IsTriangleDuplicate(uint32_t triangleId)
 {
     auto i0 = indices[triangleId * 3 + 0];
     auto i1 = indices[triangleId * 3 + 1];
@@ -262,63 +336,17 @@ bool MeshSimplifierImpl::IsTriangleDuplicate(uint32_t triangleId)
     return false;
 }
 
-float MeshSimplifierImpl::Evaluate(const glm::vec3& v0, const glm::vec3& v1, bool merge)
+float PositionHashSimplifier::Evaluate(const glm::vec3& v0, const glm::vec3& v1, bool merge)
 {
     if (v0 == v1)
         return 0.f;
+    evaluateNum++;
 
-    float error = 0;
-    std::vector<uint32_t> adjTriangles;
-    bool lock0 = false, lock1 = false;
-    GatherAdjTriangles(v0, adjTriangles, lock0);
-    GatherAdjTriangles(v1, adjTriangles, lock1);
-
+    glm::vec3 v;
+    bool lock0, lock1;
+    float error = EvaluateCost(v0, v1, adjTriangles, v, lock0, lock1);
     if (!adjTriangles.size())
         return 0.f;
-    if (adjTriangles.size() > 24) {
-        error += 0.5 * (adjTriangles.size() - 24);
-    }
-
-    /*glm::vec3 BoundsMin = {  FLT_MAX,  FLT_MAX,  FLT_MAX };
-    glm::vec3 BoundsMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };*/
-
-    Quadric q;
-    for (auto i : adjTriangles) {
-        q.Add(triQuadrics[i]);
-    }
-
-    glm::vec3 v = (v0 + v1) * 0.5f;
-    //q.Get(v);
-
-
-    auto isValidVertex = [&](const glm::vec3& v) -> bool {
-        if (glm::length(v - v0) + glm::length(v - v1) > 2 * glm::length(v0 - v1))
-            return false;
-        glm::vec3 p[3];
-        for (auto i : adjTriangles) {
-            for(int j = 0; j < 3; j++) p[j] = vertices[indices[i * 3 + j]];
-            for (int j = 0; j < 3; j++) if (p[j] == v0 || p[j] == v1) p[j] = v;
-            if (p[0] == p[1] || p[0] == p[2] || p[1] == p[2]) continue;
-            glm::vec3 n1 = glm::cross(p[1] - p[0], p[2] - p[0]);
-            glm::vec3 n2 = glm::cross(p[1] - p[0], p[2] - p[0]);
-            if (glm::dot(n1, n2) < 0) return false;
-        }
-        return true;
-    };
-
-    if (lock0 && lock1)
-        error += 1e8;
-    else if (lock0 && !lock1)
-        v = v0;
-    else if (!lock0 && lock1)
-        v = v1;
-
-    if (!isValidVertex(v)) {
-        error += 100.f;
-        v = (v0 + v1) * 0.5f;
-    }
-
-    error += q.Evaluate(v);
 
     if (merge) {
         BeginMerge(v0);
@@ -343,7 +371,7 @@ float MeshSimplifierImpl::Evaluate(const glm::vec3& v0, const glm::vec3& v1, boo
         }
         EndMerge();
 
-        std::vector<uint32_t> adjVertices;
+        adjVertices.clear();
         for (auto i : adjTriangles) {
             for (auto k = 0; k < 3; k++) {
                 adjVertices.push_back(indices[i * 3 + k]);
@@ -352,55 +380,123 @@ float MeshSimplifierImpl::Evaluate(const glm::vec3& v0, const glm::vec3& v1, boo
         std::sort(adjVertices.begin(), adjVertices.end());
         adjVertices.erase(std::unique(adjVertices.begin(), adjVertices.end()), adjVertices.end());
 
+        // lazily, only the edges of the merged vertex itself are re-evaluated right away.
         for (auto vertId : adjVertices) {
+            bool isMerged = vertices[vertId] == v;
             auto hashValue = Util::HashTable::HashValue(vertices[vertId]);
-            for (auto i = edge0Hash->First(hashValue); edge0Hash->IsValid(i); i = edge0Hash->Next(i)) {
+            for (auto i = edge0Hash.First(hashValue); edge0Hash.IsValid(i); i = edge0Hash.Next(i)) {
                 if (edges[i].first == vertices[vertId]) {
-                    if (heap.IsPresent(i)) {
-                        heap.Remove(i);
-                        reevaluateEdge.push_back(i);
-                    }
+                    MarkReevaluate(i, isMerged);
                 }
             }
 
-            for (auto i = edge1Hash->First(hashValue); edge1Hash->IsValid(i); i = edge1Hash->Next(i)) {
+            for (auto i = edge1Hash.First(hashValue); edge1Hash.IsValid(i); i = edge1Hash.Next(i)) {
                 if (edges[i].second == vertices[vertId]) {
-                    if (heap.IsPresent(i)) {
-                        heap.Remove(i);
-                        reevaluateEdge.push_back(i);
-                    }
+                    MarkReevaluate(i, isMerged);
                 }
             }
         }
         for (auto i : adjTriangles) {
-            FixupTriangle(i);
+            if (FixupTriangle(i))
+                UpdateQuadric(i);
         }
     }
+    return error;
+}
 
-    for (auto i : adjTriangles) {
-        flags[i * 3] &= (~VertexMask::AdjMask);
+float PositionHashSimplifier::EvaluateCost(const glm::vec3& v0, const glm::vec3& v1, SimplifierVector<uint32_t>& triangles, glm::vec3& v, bool& lock0, bool& lock1) const
+{
+    float error = 0;
+    triangles.clear();
+    lock0 = lock1 = false;
+    if (v0 == v1)
+        return 0.f;
+
+    GatherAdjTriangles(v0, nullptr, triangles, lock0);
+    GatherAdjTriangles(v1, &v0, triangles, lock1);
+
+    if (!triangles.size())
+        return 0.f;
+    if (triangles.size() > 24) {
+        error += 0.5 * (triangles.size() - 24);
     }
+
+    /*glm::vec3 BoundsMin = {  FLT_MAX,  FLT_MAX,  FLT_MAX };
+    glm::vec3 BoundsMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };*/
+
+    auto q = triQuadrics.Accumulate(triangles.data(), triangles.size());
+
+    v = (v0 + v1) * 0.5f;
+    //q.Get(v);
+
+
+    auto isValidVertex = [&](const glm::vec3& v) -> bool {
+        if (glm::length(v - v0) + glm::length(v - v1) > 2 * glm::length(v0 - v1))
+            return false;
+        glm::vec3 p[3];
+        for (auto i : triangles) {
+            for(int j = 0; j < 3; j++) p[j] = vertices[indices[i * 3 + j]];
+            for (int j = 0; j < 3; j++) if (p[j] == v0 || p[j] == v1) p[j] = v;
+            if (p[0] == p[1] || p[0] == p[2] || p[1] == p[2]) continue;
+            glm::vec3 n1 = glm::cross(p[1] - p[0], p[2] - p[0]);
+            glm::vec3 n2 = glm::cross(p[1] - p[0], p[2] - p[0]);
+            if (glm::dot(n1, n2) < 0) return false;
+        }
+        return true;
+    };
+
+    if (lock0 && lock1)
+        error += 1e8;
+    else if (lock0 && !lock1)
+        v = v0;
+    else if (!lock0 && lock1)
+        v = v1;
+
+    if (!isValidVertex(v)) {
+        error += 100.f;
+        v = (v0 + v1) * 0.5f;
+    }
+
+    error += q.Evaluate(v);
     return error;
 }
 
-void MeshSimplifierImpl::GatherAdjTriangles(const glm::vec3& v, std::vector<uint32_t>& triangles, bool& lock)
+void PositionHashSimplifier::MarkReevaluate(uint32_t edgeId, bool isMerged)
+{
+    if (!heap.IsPresent(edgeId))
+        return;
+    if (isLazy && !isMerged) {
+        if (!edgeDirty[edgeId])
+            heap.Update(heap.GetKey(edgeId) * lazyKeyScale, edgeId);
+        edgeDirty.SetTrue(edgeId);
+    } else {
+        edgeDirty.SetFalse(edgeId);
+        heap.Remove(edgeId);
+        reevaluateEdge.push_back(edgeId);
+    }
+}
+
+void PositionHashSimplifier::GatherAdjTriangles(const glm::vec3& v, const glm::vec3* skip, SimplifierVector<uint32_t>& triangles, bool& lock) const
 {
     auto hashValue = Util::HashTable::HashValue(v);
     for (auto i = cornerHash.First(hashValue); cornerHash.IsValid(i); i = cornerHash.Next(i)) {
         if (vertices[indices[i]] == v) {
-            auto triangleId = i / 3;
-            if ((flags[triangleId * 3] & VertexMask::AdjMask) == 0) {
-                flags[triangleId * 3] |= VertexMask::AdjMask;
-                triangles.push_back(triangleId);
-            }
             if (flags[i] & VertexMask::LockMask) {
                 lock = true;
             }
+            auto triangleId = i / 3;
+            if (skip) {
+                bool isGathered = false;
+                for (auto k = 0; k < 3; k++) isGathered |= vertices[indices[triangleId * 3 + k]] == *skip;
+                if (isGathered)
+                    continue;
+            }
+            triangles.push_back(triangleId);
         }
     }
 }
 
-void MeshSimplifierImpl::BeginMerge(const glm::vec3& v)
+void PositionHashSimplifier::BeginMerge(const glm::vec3& v)
 {
     auto hashValue = Util::HashTable::HashValue(v);
     for (auto i = vertexHash.First(hashValue); vertexHash.IsValid(i); i = vertexHash.Next(i)) {
@@ -417,24 +513,24 @@ void MeshSimplifierImpl::BeginMerge(const glm::vec3& v)
         }
     }
 
-    for (auto i = edge0Hash->First(hashValue); edge0Hash->IsValid(i); i = edge0Hash->Next(i)) {
+    for (auto i = edge0Hash.First(hashValue); edge0Hash.IsValid(i); i = edge0Hash.Next(i)) {
         if (edges[i].first == v) {
-            edge0Hash->Remove(Util::HashTable::HashValue(edges[i].first), i);
-            edge1Hash->Remove(Util::HashTable::HashValue(edges[i].second), i);
+            edge0Hash.Remove(Util::HashTable::HashValue(edges[i].first), i);
+            edge1Hash.Remove(Util::HashTable::HashValue(edges[i].second), i);
             moveEdges.push_back(i);
         }
     }
 
-    for (auto i = edge1Hash->First(hashValue); edge1Hash->IsValid(i); i = edge1Hash->Next(i)) {
+    for (auto i = edge1Hash.First(hashValue); edge1Hash.IsValid(i); i = edge1Hash.Next(i)) {
         if (edges[i].second == v) {
-            edge0Hash->Remove(Util::HashTable::HashValue(edges[i].first), i);
-            edge1Hash->Remove(Util::HashTable::HashValue(edges[i].second), i);
+            edge0Hash.Remove(Util::HashTable::HashValue(edges[i].first), i);
+            edge1Hash.Remove(Util::HashTable::HashValue(edges[i].second), i);
             moveEdges.push_back(i);
         }
     }
 }
 
-void MeshSimplifierImpl::EndMerge()
+void PositionHashSimplifier::EndMerge()
 {
     for (auto i : moveVertices) {
         vertexHash.Add(Util::HashTable::HashValue(vertices[i]), i);
@@ -453,7 +549,7 @@ void MeshSimplifierImpl::EndMerge()
     moveEdges.clear();
 }
 
-void MeshSimplifierImpl::Compact()
+void PositionHashSimplifier::Compact()
 {
     auto vertCnt = 0;
     for (auto i = 0; i < vertNum; i++) {
@@ -479,39 +575,73 @@ void MeshSimplifierImpl::Compact()
 
 // ----------------------------------------------------------------------------------
 
-MeshSimplifier::MeshSimplifier(glm::vec3* vertices, uint32_t vertNum, uint32_t* indices, uint32_t indexNum)
+MeshSimplifierImpl* CreatePositionHashSimplifier()
+{
+    return new PositionHashSimplifier();
+}
+
+MeshSimplifier::MeshSimplifier(glm::vec3* vertices, uint32_t vertNum, uint32_t* indices, uint32_t indexNum, const SimplifierConfig& config)
+    : pimpl(nullptr)
 {
-    pimpl = new MeshSimplifierImpl(vertices, vertNum, indices, indexNum);
+    Reset(vertices, vertNum, indices, indexNum, config);
+}
+
+void MeshSimplifier::Reset(glm::vec3* vertices, uint32_t vertNum, uint32_t* indices, uint32_t indexNum, const SimplifierConfig& config)
+{
+    if (pimpl && pimpl->GetCore() != config.core) {
+        delete pimpl;
+        pimpl = nullptr;
+    }
+    if (!pimpl) {
+        switch (config.core) {
+        case SimplifierCore::CornerTable:
+            pimpl = CreateCornerTableSimplifier();
+            break;
+        case SimplifierCore::IndependentSet:
+            pimpl = CreateIndependentSetSimplifier();
+            break;
+        default:
+            pimpl = CreatePositionHashSimplifier();
+            break;
+        }
+    }
+    pimpl->isLazy = config.isLazy;
+    pimpl->Reset(vertices, vertNum, indices, indexNum);
 }
 
 MeshSimplifier::~MeshSimplifier()
 {
     if (pimpl)
-        delete (MeshSimplifierImpl*)pimpl;
+        delete pimpl;
 }
 
 void MeshSimplifier::LockPosition(const glm::vec3& v)
 {
-    ((MeshSimplifierImpl*)pimpl)->LockPosition(v);
+    pimpl->LockPosition(v);
 }
 
-void MeshSimplifier::Simplify(uint32_t targetTriangleNum)
+void MeshSimplifier::Simplify(uint32_t targetTriangleNum, Util::Scheduler* scheduler)
 {
-    ((MeshSimplifierImpl*)pimpl)->Simplify(targetTriangleNum);
+    pimpl->Simplify(targetTriangleNum, scheduler);
 }
 
 uint32_t MeshSimplifier::RemainingVertNum()
 {
-    return ((MeshSimplifierImpl*)pimpl)->remainingVertNum;
+    return pimpl->remainingVertNum;
 }
 
 uint32_t MeshSimplifier::RemainingTriangleNum()
 {
-    return ((MeshSimplifierImpl*)pimpl)->remainingTriangleNum;
+    return pimpl->remainingTriangleNum;
 }
 
 float MeshSimplifier::MaxError()
 {
-    return ((MeshSimplifierImpl*)pimpl)->maxError;
+    return pimpl->maxError;
+}
+
+uint32_t MeshSimplifier::EvaluateNum()
+{
+    return pimpl->evaluateNum;
 }
 }
\ No newline at end of file
@@ -3,19 +3,48 @@
 #include <memory>
 #include <glm/glm.hpp>
 
+namespace Util {
+	class Scheduler;
+}
+
 namespace Core {
+	enum class SimplifierCore : uint32_t {
+		PositionHash,		// neighbours found by hashing positions, edges keyed by their end positions
+		CornerTable,		// welded vertex ids, per vertex corner and edge lists, integer edges
+		IndependentSet		// corner table topology, rounds of collapses with disjoint neighbourhoods run on the scheduler
+	};
+
+	const char* ToString(SimplifierCore core);
+
+	struct SimplifierConfig {
+		SimplifierCore core = SimplifierCore::PositionHash;
+		bool isLazy = false;		// re-evaluate the edges around a collapse when they are popped instead of right away, no effect on IndependentSet
+	};
+
+	class MeshSimplifierImpl;
+
 	class MeshSimplifier {
-		MeshSimplifier* pimpl;
+		MeshSimplifierImpl* pimpl;
 
 	public:
 		MeshSimplifier() : pimpl(nullptr){}
-		MeshSimplifier(glm::vec3* vertices, uint32_t vertNum, uint32_t* indices, uint32_t indexNum);
+		MeshSimplifier(glm::vec3* vertices, uint32_t vertNum, uint32_t* indices, uint32_t indexNum, const SimplifierConfig& config = {});
 		~MeshSimplifier();
 
+		MeshSimplifier(const MeshSimplifier&) = delete;
+		MeshSimplifier& operator=(const MeshSimplifier&) = delete;
+
+		// simplify new data with the buffers of the last one, no allocation once they are big enough.
+		// a different core than the last one starts from fresh buffers.
+		void Reset(glm::vec3* vertices, uint32_t vertNum, uint32_t* indices, uint32_t indexNum, const SimplifierConfig& config = {});
+
 		void LockPosition(const glm::vec3& v);
-		void Simplify(uint32_t targetTriangleNum);
+		// scheduler : computes the triangle quadrics and the first edge costs in parallel, and the rounds of the IndependentSet core.
+		// the result is the same without it.
+		void Simplify(uint32_t targetTriangleNum, Util::Scheduler* scheduler = nullptr);
 		uint32_t RemainingVertNum();
 		uint32_t RemainingTriangleNum();
 		float MaxError();
+		uint32_t EvaluateNum();
 	};
-}
\ No newline at end of file
+}
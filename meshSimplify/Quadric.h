@@ -1,19 +1,22 @@
 #pragma once
 
+#include "MemoryTracker.h"
+
 #include <memory>
 #include <glm/glm.hpp>
 
 namespace Core {
-	struct Quadric
+	template <typename T>
+	struct QuadricT
 	{
-		double a2, b2, c2, d2;
-		double ab, ac, ad, bc, bd, cd;
+		T a2, b2, c2, d2;
+		T ab, ac, ad, bc, bd, cd;
 
-		Quadric() {
-			std::memset(this, 0, sizeof(double) * 10);
+		QuadricT() {
+			std::memset(this, 0, sizeof(T) * 10);
 		}
 
-		Quadric(const glm::dvec3& v0, const glm::dvec3& v1, const glm::dvec3& v2) {
+		QuadricT(const glm::dvec3& v0, const glm::dvec3& v1, const glm::dvec3& v2) {
 			const glm::dvec3 normal = glm::normalize(glm::cross(v1 - v0, v2 - v0));
 			auto a = normal.x, b = normal.y, c = normal.z;
 			double d = -glm::dot(normal, v0);
@@ -21,9 +24,9 @@ namespace Core {
 			ab = a * b, ac = a * c, ad = a * d, bc = b * c, bd = b * d, cd = c * d;
 		}
 
-		void Add(Quadric b) {
-			double* t1 = (double*)this;
-			double* t2 = (double*)&b;
+		void Add(const QuadricT& b) {
+			T* t1 = (T*)this;
+			const T* t2 = (const T*)&b;
 			for (auto i = 0; i < 10; i++) t1[i] += t2[i];
 		}
 
@@ -42,12 +45,62 @@ namespace Core {
 			return true;
 		}
 
-		float Evaluate(const glm::vec3& p) {
-			float result = 
-				a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x
-				+ b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y
-				+ c2 * p.z * p.z + 2 * cd * p.z + d2;
-			return result <= 0.f ? 0.f : result;
+		float Evaluate(const glm::vec3& p) const {
+			T x = p.x, y = p.y, z = p.z;
+			T result =
+				a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+				+ b2 * y * y + 2 * bc * y * z + 2 * bd * y
+				+ c2 * z * z + 2 * cd * z + d2;
+			return result <= 0 ? 0.f : float(result);
+		}
+	};
+
+	using Quadric = QuadricT<double>;
+
+	// quadrics of all triangles and the batch kernels of a collapse : sum the quadrics around an edge, evaluate the
+	// sum at its candidate positions. T is the precision of the store and of the sums, float halves the memory and
+	// doubles the coefficients per vector register, at the cost of the cancellation in Evaluate.
+	// Each triangle keeps its 10 coefficients together. Ids around an edge are scattered, so one array per
+	// coefficient would cost 10 cache lines per id instead of 1 or 2.
+	template <typename T>
+	class QuadricStore {
+	public:
+		void Resize(uint32_t size) { quadrics.resize(size); }
+		uint32_t Size() const { return quadrics.size(); }
+
+		void Set(uint32_t id, const glm::dvec3& v0, const glm::dvec3& v1, const glm::dvec3& v2) {
+			QuadricT<double> q(v0, v1, v2);
+			const double* src = (const double*)&q;
+			T* dst = (T*)&quadrics[id];
+			for (uint32_t c = 0; c < 10; c++)
+				dst[c] = T(src[c]);
 		}
+
+		// sum of the quadrics of ids, added in the order of ids.
+		QuadricT<T> Accumulate(const uint32_t* ids, uint32_t count) const {
+			QuadricT<T> q;
+			T* dst = (T*)&q;
+			for (uint32_t i = 0; i < count; i++) {
+				const T* src = (const T*)&quadrics[ids[i]];
+				for (uint32_t c = 0; c < 10; c++)
+					dst[c] += src[c];
+			}
+			return q;
+		}
+
+		// errors[i] = q evaluated at positions[i], several candidates of one collapse at once.
+		static void Evaluate(const QuadricT<T>& q, const glm::vec3* positions, uint32_t count, float* errors) {
+			for (uint32_t i = 0; i < count; i++) {
+				T x = positions[i].x, y = positions[i].y, z = positions[i].z;
+				T result =
+					q.a2 * x * x + 2 * q.ab * x * y + 2 * q.ac * x * z + 2 * q.ad * x
+					+ q.b2 * y * y + 2 * q.bc * y * z + 2 * q.bd * y
+					+ q.c2 * z * z + 2 * q.cd * z + q.d2;
+				errors[i] = result <= 0 ? 0.f : float(result);
+			}
+		}
+
+	private:
+		Util::TrackedVector<QuadricT<T>, Util::MemoryTag::Simplifier> quadrics;
 	};
-}
\ No newline at end of file
+}
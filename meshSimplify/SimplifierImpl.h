@@ -0,0 +1,42 @@
+#pragma once
+
+#include "MeshSimplifier.h"
+#include "MemoryTracker.h"
+#include "Quadric.h"
+#include "Scheduler.h"
+
+namespace Core {
+template <typename T>
+using SimplifierVector = Util::TrackedVector<T, Util::MemoryTag::Simplifier>;
+
+// precision of the triangle quadrics and their sums in both cores. bench compares float against double.
+using QuadricReal = double;
+
+// a simplifier core behind MeshSimplifier. Every core collapses edges by the same quadric cost and
+// writes the same compacted output: remaining vertices first in the buffer, triangles reindexed to them.
+class MeshSimplifierImpl {
+public:
+    float maxError = 0;
+    uint32_t remainingVertNum = 0;
+    uint32_t remainingTriangleNum = 0;
+    uint32_t evaluateNum = 0; // edge costs computed by the last Simplify
+
+    // edges around a collapse are only marked dirty and get their new cost when they reach the top of the heap.
+    bool isLazy = false;
+    // a collapse can lower the cost of the edges around it, and a stale key above the new cost holds the cheaper
+    // collapse back. The key of an edge is scaled by this when it turns dirty, so it is re-evaluated sooner; half
+    // keeps the max error within a few percent of eager, small meshes included.
+    static constexpr float lazyKeyScale = 0.5f;
+
+    virtual ~MeshSimplifierImpl() = default;
+
+    virtual SimplifierCore GetCore() const = 0;
+    virtual void Reset(glm::vec3* vertices, uint32_t vertNum, uint32_t* indices, uint32_t indexNum) = 0;
+    virtual void LockPosition(const glm::vec3& v) = 0;
+    virtual void Simplify(uint32_t targetTriangleNum, Util::Scheduler* scheduler) = 0;
+};
+
+MeshSimplifierImpl* CreatePositionHashSimplifier();
+MeshSimplifierImpl* CreateCornerTableSimplifier();
+MeshSimplifierImpl* CreateIndependentSetSimplifier();
+}
@@ -1,21 +1,32 @@
 #include "BitArray.h"
 
 namespace Util {
-	BitArray::BitArray() :bits(nullptr) {}
+	BitArray::BitArray(MemoryTag memoryTag) :bits(nullptr), wordNum(0), wordCapacity(0), memoryTag(memoryTag) {}
 
-	BitArray::BitArray(uint32_t size) {
-		bits = new uint32_t[(size + 31) / 32];
-		memset(bits, 0, (size + 31) / 32 * sizeof(uint32_t));
+	BitArray::BitArray(uint32_t size, MemoryTag memoryTag) :bits(nullptr), wordNum(0), wordCapacity(0), memoryTag(memoryTag) {
+		Reset(size);
 	}
 
 	BitArray::~BitArray() {
-		if (bits) delete[] bits;
+		if (bits) {
+			delete[] bits;
+			MemoryTracker::Free(memoryTag, wordCapacity * sizeof(uint32_t));
+		}
 	}
 
 	void BitArray::Reset(uint32_t size) {
-		if (bits) delete[] bits;
-		bits = new uint32_t[(size + 31) / 32];
-		memset(bits, 0, (size + 31) / 32 * sizeof(uint32_t));
+		wordNum = (size + 31) / 32;
+		if (wordNum > wordCapacity || !bits) {
+			if (bits) {
+				delete[] bits;
+				MemoryTracker::Free(memoryTag, wordCapacity * sizeof(uint32_t));
+				bits = nullptr;
+			}
+			MemoryTracker::Allocate(memoryTag, wordNum * sizeof(uint32_t));
+			bits = new uint32_t[wordNum];
+			wordCapacity = wordNum;
+		}
+		memset(bits, 0, wordNum * sizeof(uint32_t));
 	}
 
 	void BitArray::SetFalse(uint32_t id) {
@@ -30,7 +41,7 @@ namespace Util {
 		bits[x] |= (1 << y);			// set the target to 1
 	}
 
-	bool BitArray::operator[](uint32_t id) {
+	bool BitArray::operator[](uint32_t id) const {
 		uint32_t x = id >> 5;			// divide 32
 		uint32_t y = id & 31;			// mod 31
 		return static_cast<bool>(bits[x] >> y & 1);
@@ -2,19 +2,24 @@
 
 #include <iostream>
 
+#include "MemoryTracker.h"
+
 namespace Util {
 class BitArray final {
 public:
-    BitArray();
-    BitArray(uint32_t size);
+    BitArray(MemoryTag memoryTag = MemoryTag::Other);
+    BitArray(uint32_t size, MemoryTag memoryTag = MemoryTag::Other);
     ~BitArray();
 
-    void Reset(uint32_t size);
+    void Reset(uint32_t size);      // all false, the words are kept when there are enough
     void SetFalse(uint32_t id);
     void SetTrue(uint32_t id);
-    bool operator[](uint32_t id);
+    bool operator[](uint32_t id) const;
 
 private:
     uint32_t* bits;
+    uint32_t wordNum;
+    uint32_t wordCapacity;
+    MemoryTag memoryTag;
 };
 }
\ No newline at end of file
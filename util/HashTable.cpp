@@ -1,20 +1,36 @@
 #include"HashTable.h"
 
+#include <algorithm>
+
 namespace Util {
-	HashTable::HashTable(uint32_t indexSize)
+	HashTable::HashTable(MemoryTag memoryTag)
+		: _hashSize(0)
+		, _hashCapacity(0)
+		, _hashMask(0)
+		, _indexSize(0)
+		, _hash(nullptr)
+		, _nextIndex(nullptr)
+		, _memoryTag(memoryTag)
+	{}
+
+	HashTable::HashTable(uint32_t indexSize, MemoryTag memoryTag)
 		: _hashSize(0)
+		, _hashCapacity(0)
 		, _hashMask(0)
 		, _indexSize(indexSize)
 		, _hash(nullptr)
 		, _nextIndex(nullptr)
+		, _memoryTag(memoryTag)
 	{
 		auto hashSize = LowerToPowerOfTwo(indexSize);
 		//assert(hashSize > 0);
 		assert((hashSize & (hashSize - 1)) == 0);	// to confirm hashSize is pow of 2
 
 		_hashSize = hashSize;
+		_hashCapacity = hashSize;
 		_hashMask = _hashSize - 1;
 		_indexSize = indexSize;
+		MemoryTracker::Allocate(_memoryTag, uint64_t(_hashSize + _indexSize) * 4);
 		_hash = new uint32_t[_hashSize];
 		_nextIndex = new uint32_t[_indexSize];
 		std::memset(_hash, 0xff, _hashSize * 4);
@@ -65,20 +81,83 @@ namespace Util {
 		return hash;
 	}
 
+	uint64_t HashTable::Murmur64(const void* data, size_t size, uint64_t seed) {
+		const uint64_t m = 0xc6a4a7935bd1e995ull;
+		const int r = 47;
+
+		uint64_t hash = seed ^ (size * m);
+
+		const uint8_t* bytes = (const uint8_t*)data;
+		const size_t blockNum = size / 8;
+		for (size_t i = 0; i < blockNum; i++) {
+			uint64_t k;
+			memcpy(&k, bytes + i * 8, 8);
+			k *= m;
+			k ^= k >> r;
+			k *= m;
+
+			hash ^= k;
+			hash *= m;
+		}
+
+		const uint8_t* tail = bytes + blockNum * 8;
+		switch (size & 7) {
+		case 7: hash ^= uint64_t(tail[6]) << 48; [[fallthrough]];
+		case 6: hash ^= uint64_t(tail[5]) << 40; [[fallthrough]];
+		case 5: hash ^= uint64_t(tail[4]) << 32; [[fallthrough]];
+		case 4: hash ^= uint64_t(tail[3]) << 24; [[fallthrough]];
+		case 3: hash ^= uint64_t(tail[2]) << 16; [[fallthrough]];
+		case 2: hash ^= uint64_t(tail[1]) << 8; [[fallthrough]];
+		case 1: hash ^= uint64_t(tail[0]);
+			hash *= m;
+		};
+
+		hash ^= hash >> r;
+		hash *= m;
+		hash ^= hash >> r;
+		return hash;
+	}
+
 	void HashTable::Resize(uint32_t newIndiceSize) {
+		MemoryTracker::Allocate(_memoryTag, uint64_t(newIndiceSize) * 4);
 		uint32_t* newNextIndex = new uint32_t[newIndiceSize];
 
 		if (_nextIndex) {
 			memcpy(newNextIndex, _nextIndex, _indexSize * 4);
 			delete[] _nextIndex;
+			MemoryTracker::Free(_memoryTag, uint64_t(_indexSize) * 4);
 		}
 
 		_indexSize = newIndiceSize;
 		_nextIndex = newNextIndex;
 	}
 
+	void HashTable::Reset(uint32_t indexSize) {
+		uint32_t hashSize = std::max(LowerToPowerOfTwo(indexSize), 1u);
+		if (hashSize > _hashCapacity) {
+			MemoryTracker::Allocate(_memoryTag, uint64_t(hashSize) * 4);
+			delete[] _hash;
+			MemoryTracker::Free(_memoryTag, uint64_t(_hashCapacity) * 4);
+			_hash = new uint32_t[hashSize];
+			_hashCapacity = hashSize;
+		}
+		if (indexSize > _indexSize) {
+			MemoryTracker::Allocate(_memoryTag, uint64_t(indexSize) * 4);
+			delete[] _nextIndex;
+			MemoryTracker::Free(_memoryTag, uint64_t(_indexSize) * 4);
+			_nextIndex = new uint32_t[indexSize];
+			_indexSize = indexSize;
+		}
+		_hashSize = hashSize;
+		_hashMask = _hashSize - 1;
+		std::memset(_hash, 0xff, _hashSize * 4);
+	}
+
 	void HashTable::Free() {
-		if (_indexSize) {
+		if (_hashCapacity || _indexSize) {
+			MemoryTracker::Free(_memoryTag, uint64_t(_hashCapacity + _indexSize) * 4);
+			_hashSize = 0;
+			_hashCapacity = 0;
 			_hashMask = 0;
 			_indexSize = 0;
 
@@ -95,7 +174,7 @@ namespace Util {
 	}
 
 	void HashTable::Add(uint32_t key, uint32_t index) {
-		if (index > _indexSize) {
+		if (index >= _indexSize) {
 			Resize(UpperToPowerOfTwo(index + 1));
 		}
 
@@ -5,14 +5,18 @@
 
 #include <glm/glm.hpp>
 
+#include "MemoryTracker.h"
+
 namespace Util {
 	class HashTable final {
 	public:
-		HashTable() {};
-		HashTable(uint32_t indexSize);
+		HashTable(MemoryTag memoryTag = MemoryTag::Other);
+		HashTable(uint32_t indexSize, MemoryTag memoryTag = MemoryTag::Other);
 		~HashTable();
 
 		void Resize(uint32_t newIndiceSize);
+		// empty, sized for indexSize indices; the arrays are kept when they are big enough.
+		void Reset(uint32_t indexSize);
 		void Free();
 		void Clear();
 
@@ -28,15 +32,19 @@ namespace Util {
 
 		static uint32_t Murmur32(std::initializer_list<uint32_t> initList);
 		static uint32_t MurmurFinalize32(uint32_t hash);
+		static uint64_t Murmur64(const void* data, size_t size, uint64_t seed = 0);
 
 		static uint32_t HashValue(const glm::vec3& v);
 
 	private:
 		uint32_t _hashSize;
+		uint32_t _hashCapacity;
 		uint32_t _hashMask;
 		uint32_t _indexSize;
 
 		uint32_t* _hash;
 		uint32_t* _nextIndex;
+
+		MemoryTag _memoryTag;
 	};
 }
\ No newline at end of file
@@ -3,11 +3,13 @@
 #include <assert.h>
 
 namespace Util {
-    Heap::Heap() : _size(0), _indexNum(0), _heap(nullptr), _keys(nullptr), _heapIndices(nullptr){}
+    Heap::Heap(MemoryTag memoryTag) : _size(0), _indexNum(0), _capacity(0), _heap(nullptr), _keys(nullptr), _heapIndices(nullptr), _memoryTag(memoryTag) {}
 
-    Heap::Heap(uint32_t _num_index) {
+    Heap::Heap(uint32_t _num_index, MemoryTag memoryTag) : _memoryTag(memoryTag) {
         _size = 0;
         _indexNum = _num_index;
+        _capacity = _num_index;
+        MemoryTracker::Allocate(_memoryTag, uint64_t(_indexNum) * 12);
         _heap = new uint32_t[_indexNum];
         _keys = new float[_indexNum];
         _heapIndices = new uint32_t[_indexNum];
@@ -15,15 +17,37 @@ namespace Util {
     }
 
     void Heap::Resize(uint32_t _num_index) {
+        if (_num_index <= _capacity) {
+            _size = 0;
+            _indexNum = _num_index;
+            memset(_heapIndices, 0xff, _indexNum * sizeof(uint32_t));
+            return;
+        }
         Free();
+        MemoryTracker::Allocate(_memoryTag, uint64_t(_num_index) * 12);
         _size = 0;
         _indexNum = _num_index;
+        _capacity = _num_index;
         _heap = new uint32_t[_indexNum];
         _keys = new float[_indexNum];
         _heapIndices = new uint32_t[_indexNum];
         memset(_heapIndices, 0xff, _indexNum * sizeof(uint32_t));
     }
 
+    void Heap::Build(std::span<const float> keys) {
+        uint32_t n = keys.size();
+        Resize(n);
+        _size = n;
+        for (uint32_t i = 0; i < n; i++) {
+            _heap[i] = i;
+            _keys[i] = keys[i];
+            _heapIndices[i] = i;
+        }
+        for (uint32_t i = n / 2; i-- > 0;) {
+            PushDown(i);
+        }
+    }
+
     void Heap::PushUp(uint32_t i) {
         uint32_t idx = _heap[i];
         uint32_t fa = (i - 1) >> 1;
@@ -69,9 +93,11 @@ namespace Util {
         assert(_size > 0);
 
         uint32_t idx = _heap[0];
-        _heap[0] = _heap[--_size];
-        _heapIndices[_heap[0]] = 0;
         _heapIndices[idx] = ~0u;
+        if (--_size == 0) return;     // PushDown would mark idx present again
+
+        _heap[0] = _heap[_size];
+        _heapIndices[_heap[0]] = 0;
         PushDown(0);
     }
 
@@ -1,17 +1,22 @@
 #pragma once
 
 #include <iostream>
+#include <span>
+
+#include "MemoryTracker.h"
 
 namespace Util {
 	class Heap final{
 	public:
-		Heap();
-		Heap(uint32_t indexNum);
+		Heap(MemoryTag memoryTag = MemoryTag::Other);
+		Heap(uint32_t indexNum, MemoryTag memoryTag = MemoryTag::Other);
 		~Heap() { Free(); }
 
 		void Free() {
+			MemoryTracker::Free(_memoryTag, uint64_t(_capacity) * 12);
 			_size = 0;
 			_indexNum = 0;
+			_capacity = 0;
 			if (_heap) {
 				delete[] _heap;
 				_heap = nullptr;
@@ -25,7 +30,8 @@ namespace Util {
 				_heapIndices = nullptr;
 			}
 		}
-		void Resize(uint32_t indexNum);
+		void Resize(uint32_t indexNum);		// empty, for indices [0, indexNum); the arrays are kept when big enough
+		void Build(std::span<const float> keys);	// all of [0, keys.size()) present with their keys, bottom-up in O(n)
 		float GetKey(uint32_t idx);
 		void Clear();
 		bool Empty() { return _size == 0; }
@@ -39,9 +45,11 @@ namespace Util {
 	private:
 		uint32_t _size;
 		uint32_t _indexNum;
+		uint32_t _capacity;
 		uint32_t* _heap;
 		float* _keys;
 		uint32_t* _heapIndices;
+		MemoryTag _memoryTag;
 
 		void PushUp(uint32_t i);
 		void PushDown(uint32_t i);
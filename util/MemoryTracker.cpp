@@ -0,0 +1,74 @@
+#include "MemoryTracker.h"
+
+#include <string>
+
+namespace Util {
+	static const uint32_t tagNum = (uint32_t)MemoryTag::Count;
+
+	static std::atomic<uint64_t> currentBytes[tagNum + 1];		// last one is the total
+	static std::atomic<uint64_t> peakBytes[tagNum + 1];
+	static std::atomic<uint64_t> limitBytes = 0;
+
+	static void UpdatePeak(uint32_t id, uint64_t value) {
+		uint64_t peak = peakBytes[id].load(std::memory_order_relaxed);
+		while (value > peak && !peakBytes[id].compare_exchange_weak(peak, value, std::memory_order_relaxed)) {}
+	}
+
+	const char* ToString(MemoryTag tag) {
+		switch (tag) {
+		case MemoryTag::Mesh: return "mesh";
+		case MemoryTag::Simplifier: return "simplifier";
+		case MemoryTag::Partitioner: return "partitioner";
+		case MemoryTag::Cluster: return "cluster";
+		case MemoryTag::Encode: return "encode";
+		default: return "other";
+		}
+	}
+
+	void MemoryTracker::Allocate(MemoryTag tag, uint64_t bytes) {
+		uint32_t id = (uint32_t)tag;
+		uint64_t total = currentBytes[tagNum].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+
+		uint64_t limit = limitBytes.load(std::memory_order_relaxed);
+		if (limit != 0 && total > limit) {
+			currentBytes[tagNum].fetch_sub(bytes, std::memory_order_relaxed);
+			throw MemoryLimitExceeded("memory limit exceeded: " + std::string(ToString(tag)) + " asked for " + std::to_string(bytes)
+				+ " bytes with " + std::to_string(total - bytes) + " of " + std::to_string(limit) + " bytes in use");
+		}
+
+		uint64_t current = currentBytes[id].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+		UpdatePeak(id, current);
+		UpdatePeak(tagNum, total);
+	}
+
+	void MemoryTracker::Free(MemoryTag tag, uint64_t bytes) {
+		currentBytes[(uint32_t)tag].fetch_sub(bytes, std::memory_order_relaxed);
+		currentBytes[tagNum].fetch_sub(bytes, std::memory_order_relaxed);
+	}
+
+	void MemoryTracker::SetLimit(uint64_t bytes) {
+		limitBytes = bytes;
+	}
+
+	uint64_t MemoryTracker::GetLimit() {
+		return limitBytes;
+	}
+
+	MemoryUsage MemoryTracker::GetCurrent() {
+		MemoryUsage usage;
+		for (uint32_t i = 0; i < tagNum; i++) usage.tags[i] = currentBytes[i];
+		usage.total = currentBytes[tagNum];
+		return usage;
+	}
+
+	MemoryUsage MemoryTracker::GetPeak() {
+		MemoryUsage usage;
+		for (uint32_t i = 0; i < tagNum; i++) usage.tags[i] = peakBytes[i];
+		usage.total = peakBytes[tagNum];
+		return usage;
+	}
+
+	void MemoryTracker::ResetPeak() {
+		for (uint32_t i = 0; i <= tagNum; i++) peakBytes[i] = currentBytes[i].load();
+	}
+}
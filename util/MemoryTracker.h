@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace Util {
+	enum class MemoryTag : uint32_t {
+		Mesh,
+		Simplifier,
+		Partitioner,		// edge links, adjacency graphs and metis data
+		Cluster,
+		Encode,
+		Other,
+		Count
+	};
+
+	const char* ToString(MemoryTag tag);
+
+	class MemoryLimitExceeded : public std::runtime_error {
+	public:
+		using std::runtime_error::runtime_error;
+	};
+
+	struct MemoryUsage {
+		uint64_t total = 0;
+		uint64_t tags[(uint32_t)MemoryTag::Count] = {};
+	};
+
+	// process wide byte counters per subsystem, fed by TrackingAllocator and the raw arrays in util.
+	// there is one tracker for the whole process, not one per build : the usage, the peak and the limit add up
+	// everything allocated on any thread. peaks and limits describe a single build only when it runs alone, two
+	// builds running together see each other's memory and the limit throws in whichever build passes it.
+	class MemoryTracker final {
+	public:
+		// throws MemoryLimitExceeded (and counts nothing) when the limit would be passed.
+		static void Allocate(MemoryTag tag, uint64_t bytes);
+		static void Free(MemoryTag tag, uint64_t bytes);
+
+		static void SetLimit(uint64_t bytes);		// 0 : no limit
+		static uint64_t GetLimit();
+
+		static MemoryUsage GetCurrent();
+		static MemoryUsage GetPeak();
+		static void ResetPeak();					// peaks restart from the current usage
+	};
+
+	// accounts memory the tracker cannot see allocated, e.g. buffers owned by the caller, for a scope.
+	class ScopedMemory final {
+	public:
+		ScopedMemory(MemoryTag tag, uint64_t bytes) : _tag(tag), _bytes(bytes) { MemoryTracker::Allocate(_tag, _bytes); }
+		~ScopedMemory() { MemoryTracker::Free(_tag, _bytes); }
+
+		ScopedMemory(const ScopedMemory&) = delete;
+		ScopedMemory& operator=(const ScopedMemory&) = delete;
+
+	private:
+		MemoryTag _tag;
+		uint64_t _bytes;
+	};
+
+	template <typename T, MemoryTag Tag>
+	class TrackingAllocator {
+	public:
+		using value_type = T;
+
+		template <typename U>
+		struct rebind { using other = TrackingAllocator<U, Tag>; };
+
+		TrackingAllocator() = default;
+		template <typename U>
+		TrackingAllocator(const TrackingAllocator<U, Tag>&) {}
+
+		T* allocate(size_t n) {
+			MemoryTracker::Allocate(Tag, n * sizeof(T));
+			return std::allocator<T>().allocate(n);
+		}
+
+		void deallocate(T* p, size_t n) {
+			MemoryTracker::Free(Tag, n * sizeof(T));
+			std::allocator<T>().deallocate(p, n);
+		}
+
+		template <typename U>
+		bool operator==(const TrackingAllocator<U, Tag>&) const { return true; }
+		template <typename U>
+		bool operator!=(const TrackingAllocator<U, Tag>&) const { return false; }
+	};
+
+	template <typename T, MemoryTag Tag>
+	using TrackedVector = std::vector<T, TrackingAllocator<T, Tag>>;
+}
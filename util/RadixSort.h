@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Scheduler.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace Util {
+	// a key of WordNum 32 bit words, words[WordNum - 1] is the most significant; value rides along.
+	template <uint32_t WordNum>
+	struct RadixItem {
+		uint32_t words[WordNum];
+		uint32_t value;
+	};
+
+	// stable LSD radix sort by 8 bit digits. Items are split into fixed chunks that count and scatter on the
+	// scheduler, so the result never depends on the thread count. A digit that is the same for all items is skipped,
+	// which drops most passes of small integer keys. scratch keeps its capacity for the next sort.
+	template <uint32_t WordNum, typename Allocator>
+	void RadixSort(std::vector<RadixItem<WordNum>, Allocator>& items, std::vector<RadixItem<WordNum>, Allocator>& scratch, Scheduler* scheduler = nullptr) {
+		const uint32_t chunkSize = 16384;
+		const uint32_t itemNum = items.size();
+		const uint32_t chunkNum = (itemNum + chunkSize - 1) / chunkSize;
+		if (itemNum <= 1) return;
+
+		auto forEachChunk = [&](auto&& func) {
+			if (scheduler && chunkNum > 1) scheduler->ParallelFor(chunkNum, func);
+			else for (uint32_t chunk = 0; chunk < chunkNum; chunk++) func(chunk);
+		};
+
+		scratch.resize(itemNum);
+		// a single chunk counts on the stack, so small sorts with a reused scratch allocate nothing.
+		uint32_t stackOffsets[256];
+		std::vector<uint32_t> heapOffsets(chunkNum > 1 ? chunkNum * 256 : 0);
+		uint32_t* offsets = chunkNum > 1 ? heapOffsets.data() : stackOffsets;
+		for (uint32_t pass = 0; pass < WordNum * 4; pass++) {
+			const uint32_t word = pass / 4, shift = (pass % 4) * 8;
+
+			std::fill(offsets, offsets + chunkNum * 256, 0);
+			forEachChunk([&](uint32_t chunk) {
+				uint32_t* counts = &offsets[chunk * 256];
+				for (uint32_t i = chunk * chunkSize, end = std::min(itemNum, i + chunkSize); i < end; i++)
+					counts[(items[i].words[word] >> shift) & 255]++;
+			});
+
+			// exclusive prefix in (digit, chunk) order, which keeps equal digits in their input order.
+			uint32_t sum = 0;
+			bool isSkipped = false;
+			for (uint32_t digit = 0; digit < 256 && !isSkipped; digit++) {
+				uint32_t digitSum = sum;
+				for (uint32_t chunk = 0; chunk < chunkNum; chunk++) {
+					uint32_t count = offsets[chunk * 256 + digit];
+					offsets[chunk * 256 + digit] = sum;
+					sum += count;
+				}
+				isSkipped = sum - digitSum == itemNum;
+			}
+			if (isSkipped) continue;
+
+			forEachChunk([&](uint32_t chunk) {
+				uint32_t* next = &offsets[chunk * 256];
+				for (uint32_t i = chunk * chunkSize, end = std::min(itemNum, i + chunkSize); i < end; i++)
+					scratch[next[(items[i].words[word] >> shift) & 255]++] = items[i];
+			});
+			items.swap(scratch);
+		}
+	}
+}
@@ -0,0 +1,181 @@
+#include "Scheduler.h"
+#include <algorithm>
+#include <assert.h>
+
+namespace Util {
+	// which pool the current thread works for and its queue there, so nested schedulers keep apart.
+	static thread_local const Scheduler* currentScheduler = nullptr;
+	static thread_local uint32_t currentQueueIndex = 0;
+
+	Scheduler::Scheduler(uint32_t threadNum)
+		: _threadNum(threadNum)
+		, _queuedTaskNum(0)
+		, _quit(false)
+	{
+		if (_threadNum == 0) {
+			_threadNum = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		for (uint32_t i = 0; i < _threadNum; i++) {
+			_queues.push_back(std::make_unique<TaskQueue>());
+		}
+
+		// the calling thread works as well, so only spawn (threadNum - 1) workers.
+		for (uint32_t i = 1; i < _threadNum; i++) {
+			_workers.emplace_back(&Scheduler::WorkerLoop, this, i);
+		}
+	}
+
+	Scheduler::~Scheduler() {
+		{
+			std::lock_guard<std::mutex> lock(_sleepMutex);
+			_quit = true;
+		}
+		_wakeCondition.notify_all();
+		for (auto& worker : _workers) {
+			worker.join();
+		}
+	}
+
+	uint32_t Scheduler::GetQueueIndex() const {
+		return currentScheduler == this ? currentQueueIndex : 0;
+	}
+
+	void Scheduler::Spawn(TaskGroup& group, std::function<void()> task) {
+		group._pending++;
+		auto& queue = *_queues[GetQueueIndex()];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.tasks.push_back({ std::move(task), &group });
+		}
+		_queuedTaskNum++;
+
+		if (!_workers.empty()) {
+			{ std::lock_guard<std::mutex> lock(_sleepMutex); }		// a worker checking for work cannot miss this wake
+			_wakeCondition.notify_one();
+		}
+	}
+
+	void Scheduler::Wait(TaskGroup& group) {
+		uint32_t queueIndex = GetQueueIndex();
+		while (group._pending > 0) {
+			if (!RunTask(queueIndex)) std::this_thread::yield();		// the rest is running on other threads
+		}
+
+		if (group._exception) {
+			std::exception_ptr exception = nullptr;
+			std::swap(exception, group._exception);
+			std::rethrow_exception(exception);
+		}
+	}
+
+	bool Scheduler::RunTask(uint32_t queueIndex) {
+		Task task;
+		bool isFound = false;
+
+		// newest of the own queue first, it is the hottest in cache, then the oldest of the others,
+		// which is the biggest piece of work in fork-join recursions.
+		for (uint32_t i = 0; i < _threadNum && !isFound; i++) {
+			auto& queue = *_queues[(queueIndex + i) % _threadNum];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.tasks.empty()) continue;
+			if (i == 0) {
+				task = std::move(queue.tasks.back());
+				queue.tasks.pop_back();
+			}
+			else {
+				task = std::move(queue.tasks.front());
+				queue.tasks.pop_front();
+			}
+			isFound = true;
+		}
+		if (!isFound) return false;
+		_queuedTaskNum--;
+
+		try {
+			task.func();
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(task.group->_mutex);
+			if (!task.group->_exception) task.group->_exception = std::current_exception();
+		}
+		task.group->_pending--;
+		return true;
+	}
+
+	void Scheduler::WorkerLoop(uint32_t queueIndex) {
+		currentScheduler = this;
+		currentQueueIndex = queueIndex;
+
+		while (true) {
+			if (RunTask(queueIndex)) continue;
+
+			std::unique_lock<std::mutex> lock(_sleepMutex);
+			_wakeCondition.wait(lock, [this] { return _quit || _queuedTaskNum > 0; });
+			if (_quit) return;
+		}
+	}
+
+	uint32_t TaskGraph::Add(std::function<void()> task, std::initializer_list<uint32_t> dependencies) {
+		uint32_t id = _nodes.size();
+		_nodes.push_back({ std::move(task), {}, uint32_t(dependencies.size()) });
+		for (uint32_t dependency : dependencies) {
+			assert(dependency < id);
+			_nodes[dependency].successors.push_back(id);
+		}
+		return id;
+	}
+
+	void TaskGraph::Run(Scheduler& scheduler) {
+		std::vector<std::atomic<uint32_t>> pending(_nodes.size());
+		for (uint32_t i = 0; i < _nodes.size(); i++) pending[i] = _nodes[i].dependencyNum;
+
+		// a task that throws never gets here, so its successors stay pending and the group still drains.
+		Scheduler::TaskGroup group;
+		std::function<void(uint32_t)> run = [&](uint32_t id) {
+			_nodes[id].func();
+			for (uint32_t next : _nodes[id].successors) {
+				if (--pending[next] == 0) scheduler.Spawn(group, [&run, next] { run(next); });
+			}
+		};
+		for (uint32_t i = 0; i < _nodes.size(); i++) {
+			if (_nodes[i].dependencyNum == 0) scheduler.Spawn(group, [&run, i] { run(i); });
+		}
+		scheduler.Wait(group);
+	}
+
+	void Scheduler::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func) {
+		if (_workers.empty() || count <= 1) {
+			for (uint32_t i = 0; i < count; i++) func(i);
+			return;
+		}
+
+		// items may differ a lot in cost (e.g. cluster groups), so hand them out one at a time.
+		std::atomic<uint32_t> nextIndex = 0;
+		auto drain = [&] {
+			for (uint32_t i = nextIndex++; i < count; i = nextIndex++) {
+				try {
+					func(i);
+				}
+				catch (...) {
+					nextIndex = count;
+					throw;
+				}
+			}
+		};
+
+		TaskGroup group;
+		uint32_t helperNum = std::min<uint32_t>(_workers.size(), count - 1);
+		for (uint32_t i = 0; i < helperNum; i++) {
+			Spawn(group, drain);
+		}
+		try {
+			drain();
+		}
+		catch (...) {
+			Wait(group);		// the helpers still reference this frame
+			throw;
+		}
+		Wait(group);
+	}
+}
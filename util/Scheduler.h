@@ -0,0 +1,138 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Util {
+	// work-stealing pool: every thread owns a deque, pops its newest task and steals the oldest from others.
+	class Scheduler final {
+	public:
+		// tasks spawned into a group, Wait returns once all of them (and the tasks they spawned into it) are done.
+		class TaskGroup final {
+		public:
+			TaskGroup() : _pending(0) {}
+			TaskGroup(const TaskGroup&) = delete;
+			TaskGroup& operator=(const TaskGroup&) = delete;
+
+		private:
+			friend class Scheduler;
+			std::atomic<uint32_t> _pending;
+			std::mutex _mutex;
+			std::exception_ptr _exception;		// the first one thrown by a task
+		};
+
+		Scheduler(uint32_t threadNum = 0);		// 0 : use all hardware threads
+		~Scheduler();
+
+		Scheduler(const Scheduler&) = delete;
+		Scheduler& operator=(const Scheduler&) = delete;
+
+		uint32_t GetThreadNum() const { return _threadNum; }
+		// [0, threadNum) of the calling thread, 0 for threads outside the pool.
+		uint32_t GetThreadIndex() const { return GetQueueIndex(); }
+
+		void Spawn(TaskGroup& group, std::function<void()> task);
+		// runs queued tasks while waiting, so it may be called from inside a task; rethrows the first task exception.
+		void Wait(TaskGroup& group);
+
+		// run func(i) for i in [0, count), the calling thread takes part in the work and blocks until all done.
+		// the first exception thrown by func stops handing out items and is rethrown here.
+		void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func);
+
+	private:
+		struct Task {
+			std::function<void()> func;
+			TaskGroup* group;
+		};
+
+		struct TaskQueue {
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		uint32_t _threadNum;
+		std::vector<std::thread> _workers;
+		std::vector<std::unique_ptr<TaskQueue>> _queues;		// [0] is shared by the threads outside the pool
+
+		std::mutex _sleepMutex;
+		std::condition_variable _wakeCondition;
+		std::atomic<uint32_t> _queuedTaskNum;
+		bool _quit;
+
+		uint32_t GetQueueIndex() const;
+		bool RunTask(uint32_t queueIndex);
+		void WorkerLoop(uint32_t queueIndex);
+	};
+
+	// tasks that each start once the tasks they depend on are done, e.g. the stages of a build that only share some inputs.
+	class TaskGraph final {
+	public:
+		// dependencies : ids returned by earlier Add calls, so the graph has no cycle.
+		uint32_t Add(std::function<void()> task, std::initializer_list<uint32_t> dependencies = {});
+
+		// runs every task once, the calling thread takes part. Rethrows the first exception, the tasks that depend on
+		// the one that threw are skipped.
+		void Run(Scheduler& scheduler);
+
+	private:
+		struct Node {
+			std::function<void()> func;
+			std::vector<uint32_t> successors;
+			uint32_t dependencyNum = 0;
+		};
+		std::vector<Node> _nodes;
+	};
+
+	// one T per thread of a scheduler, for scratch buffers that keep their capacity from item to item without locking.
+	// Threads outside the pool share slot 0, so only one of them may use it at a time.
+	template <typename T>
+	class PerThread final {
+	public:
+		PerThread(const Scheduler* scheduler) : _scheduler(scheduler), _slots(scheduler ? scheduler->GetThreadNum() : 1) {}
+
+		T& Get() { return _slots[_scheduler ? _scheduler->GetThreadIndex() : 0]; }
+
+	private:
+		const Scheduler* _scheduler;
+		std::vector<T> _slots;
+	};
+
+	// func(begin, end) over [0, count) in fixed chunks, on the scheduler when there is one and more than one chunk.
+	// Each item is in exactly one call, so results written per item never depend on the thread count.
+	template <typename Func>
+	void ForEachChunk(Scheduler* scheduler, uint32_t count, Func&& func, uint32_t chunkSize = 4096) {
+		uint32_t chunkNum = (count + chunkSize - 1) / chunkSize;
+		if (!scheduler || chunkNum <= 1) {
+			func(0u, count);
+			return;
+		}
+		scheduler->ParallelFor(chunkNum, [&](uint32_t chunk) {
+			func(chunk * chunkSize, std::min(count, (chunk + 1) * chunkSize));
+		});
+	}
+
+	// combine(init, func(begin, end)) over the chunks of ForEachChunk. The chunk results are combined in chunk order
+	// on the calling thread, so even a float sum does not depend on the thread count.
+	template <typename T, typename Func, typename Combine>
+	T ParallelReduce(Scheduler* scheduler, uint32_t count, T init, Func&& func, Combine&& combine, uint32_t chunkSize = 4096) {
+		uint32_t chunkNum = (count + chunkSize - 1) / chunkSize;
+		if (chunkNum == 0) return init;
+		std::vector<T> results(chunkNum, init);
+		ForEachChunk(scheduler, count, [&](uint32_t begin, uint32_t end) {
+			results[begin / chunkSize] = func(begin, end);
+		}, chunkSize);
+
+		T result = init;
+		for (const auto& chunkResult : results) result = combine(result, chunkResult);
+		return result;
+	}
+}
@@ -12,7 +12,20 @@ namespace Util {
     inline uint32_t Cycle3(uint32_t i, uint32_t offset)
     {
         uint32_t imod3 = i % 3;
-        return i - imod3 + ((1 + offset) % 3);
+        return i - imod3 + ((imod3 + offset) % 3);
+    }
+
+    // interleaves the low 10 bits of each coordinate as zyxzyx...
+    inline uint32_t MortonCode(uint32_t x, uint32_t y, uint32_t z)
+    {
+        auto expandBits = [](uint32_t v) {
+            v = (v * 0x00010001u) & 0xFF0000FFu;
+            v = (v * 0x00000101u) & 0x0F00F00Fu;
+            v = (v * 0x00000011u) & 0xC30C30C3u;
+            v = (v * 0x00000005u) & 0x49249249u;
+            return v;
+        };
+        return expandBits(x) | (expandBits(y) << 1) | (expandBits(z) << 2);
     }
 
     inline uint32_t Float2Uint(float x)
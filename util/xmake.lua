@@ -5,4 +5,7 @@ target("util")
     add_files("*.cpp")
     add_packages("glm")
     add_includedirs(".",{public=true})
-target_end()
\ No newline at end of file
+    if is_plat("linux", "macosx") then
+        add_syslinks("pthread", {public = true})
+    end
+target_end()
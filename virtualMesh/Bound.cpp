@@ -1,8 +1,15 @@
 #include "Bound.h"
 
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define BOUND_SIMD
+#include <emmintrin.h>
+#endif
+
 namespace Core {
 	Bounds Bounds::operator+(const glm::vec3& other) {
-		Bounds bounds;
+		Bounds bounds = *this;
 		for (uint32_t i = 0; i < 3; i++) {
 			bounds.pMin[i] = std::min(other[i], bounds.pMin[i]);
 			bounds.pMax[i] = std::max(other[i], bounds.pMax[i]);
@@ -11,7 +18,7 @@ namespace Core {
 	}
 
 	Bounds Bounds::operator+(const Bounds& other) {
-		Bounds bounds;
+		Bounds bounds = *this;
 		for (uint32_t i = 0; i < 3; i++) {
 			bounds.pMin[i] = std::min(other.pMin[i], bounds.pMin[i]);
 			bounds.pMax[i] = std::max(other.pMax[i], bounds.pMax[i]);
@@ -31,64 +38,166 @@ namespace Core {
 		return sphere;
 	}
 
-	Sphere Sphere::FromPoints(const std::vector<glm::vec3>& pos, uint32_t size) {
-		std::vector<uint32_t> minIdx(3);
-		std::vector<uint32_t> maxIdx(3);
-		for (auto i = 0; i < size; i++) {
-			for (auto k = 0; k < 3; k++) {
-				if (pos[i][k] < pos[minIdx[k]][k]) minIdx[k] = i;
-				if (pos[i][k] > pos[maxIdx[k]][k]) maxIdx[k] = i;
+	// the farthest of the points from center and its squared distance, four points a step where SSE is there.
+	static uint32_t FarthestPoint(const glm::vec3* pos, uint32_t size, const glm::vec3& center, float& maxDist2) {
+		uint32_t maxIdx = 0;
+		maxDist2 = -1.f;
+		uint32_t i = 0;
+#ifdef BOUND_SIMD
+		static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "points are read as packed floats");
+		if (size >= 4) {
+			const __m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+			__m128 best = _mm_set1_ps(-1.f);
+			__m128i bestIdx = _mm_setzero_si128();
+			__m128i idx = _mm_setr_epi32(0, 1, 2, 3);
+			const __m128i step = _mm_set1_epi32(4);
+			for (; i + 4 <= size; i += 4) {
+				// 4 points are 12 floats: x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3, transposed to xxxx yyyy zzzz.
+				const float* p = &pos[i].x;
+				__m128 a = _mm_loadu_ps(p), b = _mm_loadu_ps(p + 4), c = _mm_loadu_ps(p + 8);
+				__m128 x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+				__m128 y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+				__m128 z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+				x = _mm_sub_ps(x, cx);
+				y = _mm_sub_ps(y, cy);
+				z = _mm_sub_ps(z, cz);
+				__m128 dist2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+				__m128i isFarther = _mm_castps_si128(_mm_cmpgt_ps(dist2, best));
+				best = _mm_max_ps(best, dist2);
+				bestIdx = _mm_or_si128(_mm_and_si128(isFarther, idx), _mm_andnot_si128(isFarther, bestIdx));
+				idx = _mm_add_epi32(idx, step);
+			}
+			alignas(16) float lanes[4];
+			alignas(16) uint32_t laneIdx[4];
+			_mm_store_ps(lanes, best);
+			_mm_store_si128((__m128i*)laneIdx, bestIdx);
+			for (uint32_t k = 0; k < 4; k++) {
+				if (lanes[k] > maxDist2) {
+					maxDist2 = lanes[k];
+					maxIdx = laneIdx[k];
+				}
 			}
 		}
-
-		float maxLen = 0;
-		uint32_t maxAxis = 0;
-		for (auto k = 0; k < 3; k++) {
-			glm::vec3 pMin = pos[minIdx[k]];
-			glm::vec3 pMax = pos[maxIdx[k]];
-			float len = glm::length(pMax - pMin);
-			if (len > maxLen) {
-				maxLen = len;
-				maxAxis = k;
+#endif
+		for (; i < size; i++) {
+			glm::vec3 v = pos[i] - center;
+			float dist2 = glm::dot(v, v);
+			if (dist2 > maxDist2) {
+				maxDist2 = dist2;
+				maxIdx = i;
 			}
 		}
-		glm::vec3 pMin = pos[minIdx[maxAxis]];
-		glm::vec3 pMax = pos[maxIdx[maxAxis]];
+		return maxIdx;
+	}
 
-		Sphere sphere;
-		sphere.center = (pMax + pMin) * 0.5f;
-		sphere.radius = maxLen * 0.5f;
+	// smallest ball with at most 5 points, the basis are the points on its boundary that define it.
+	struct MiniBall {
+		glm::dvec3 center = glm::dvec3(0);
+		double radius2 = -1;		// empty
+		uint32_t basis[4];
+		uint32_t basisNum = 0;
+	};
 
-		maxLen = sphere.radius;
+	// the smallest ball with all of the boundary points on its surface.
+	static MiniBall CircumBall(const glm::dvec3* points, const uint32_t* boundary, uint32_t boundaryNum) {
+		MiniBall ball;
+		ball.basisNum = boundaryNum;
+		for (uint32_t i = 0; i < boundaryNum; i++) ball.basis[i] = boundary[i];
+		if (boundaryNum == 0) return ball;
 
-		for (auto i = 0; i < size; i++) {
-			float len = glm::length(pos[i] - sphere.center);
-			if (len > maxLen) {
-				float t = 0.5 * (len - sphere.radius) / len;
-				sphere.center = sphere.center + (pos[i] - sphere.center) * t;
-				sphere.radius = (sphere.radius + len) * 0.5f;
-				maxLen = len;
-			}
+		glm::dvec3 a = points[boundary[0]];
+		if (boundaryNum == 1) {
+			ball.center = a;
+			ball.radius2 = 0;
+			return ball;
+		}
+
+		glm::dvec3 u = points[boundary[1]] - a;
+		glm::dvec3 offset = u * 0.5;
+		if (boundaryNum == 3) {
+			glm::dvec3 v = points[boundary[2]] - a;
+			glm::dvec3 n = glm::cross(u, v);
+			double denom = 2 * glm::dot(n, n);
+			if (denom > 1e-30) offset = (glm::dot(v, v) * glm::cross(n, u) + glm::dot(u, u) * glm::cross(v, n)) / denom;
+		} else if (boundaryNum == 4) {
+			glm::dvec3 v = points[boundary[2]] - a;
+			glm::dvec3 w = points[boundary[3]] - a;
+			double denom = 2 * glm::dot(u, glm::cross(v, w));
+			if (std::abs(denom) > 1e-30) offset = (glm::dot(u, u) * glm::cross(v, w) + glm::dot(v, v) * glm::cross(w, u) + glm::dot(w, w) * glm::cross(u, v)) / denom;
+		}
+		// degenerated boundaries fall back to a smaller ball, grown until it holds them all.
+		ball.center = a + offset;
+		for (uint32_t i = 0; i < boundaryNum; i++) {
+			glm::dvec3 d = points[boundary[i]] - ball.center;
+			ball.radius2 = std::max(ball.radius2, glm::dot(d, d));
+		}
+		return ball;
+	}
+
+	// Welzl's recursion on the first n points with the boundary ones fixed on the surface.
+	static MiniBall Welzl(const glm::dvec3* points, uint32_t n, uint32_t* boundary, uint32_t boundaryNum) {
+		if (n == 0 || boundaryNum == 4) return CircumBall(points, boundary, boundaryNum);
+		MiniBall ball = Welzl(points, n - 1, boundary, boundaryNum);
+		glm::dvec3 d = points[n - 1] - ball.center;
+		if (ball.radius2 >= 0 && glm::dot(d, d) <= ball.radius2 * (1 + 1e-10)) return ball;
+		boundary[boundaryNum] = n - 1;
+		return Welzl(points, n - 1, boundary, boundaryNum + 1);
+	}
+
+	// minimal sphere by pivoting: the ball of a basis of at most 4 points grows by the farthest point outside it,
+	// Welzl's algorithm on the basis and that point gives the next basis, until no point is outside.
+	Sphere Sphere::FromPoints(const glm::vec3* pos, uint32_t size) {
+		if (size == 0) return { glm::vec3(0), 0.f };
+
+		uint32_t basis[5] = { 0 };
+		uint32_t basisNum = 1;
+		glm::vec3 center = pos[0];
+		float radius2 = 0;
+		float maxDist2 = 0;
+		for (uint32_t iter = 0; iter < 64; iter++) {
+			uint32_t farthest = FarthestPoint(pos, size, center, maxDist2);
+			if (maxDist2 <= radius2 * (1.f + 1e-5f)) break;
+
+			// the new point last, it is outside the ball of the basis so the recursion fixes it on the boundary first.
+			glm::dvec3 points[5];
+			for (uint32_t i = 0; i < basisNum; i++) points[i] = pos[basis[i]];
+			points[basisNum] = pos[farthest];
+			basis[basisNum] = farthest;
+
+			uint32_t boundary[4];
+			uint32_t ids[5];
+			std::copy(basis, basis + basisNum + 1, ids);
+			MiniBall ball = Welzl(points, basisNum + 1, boundary, 0);
+			for (uint32_t i = 0; i < ball.basisNum; i++) basis[i] = ids[ball.basis[i]];
+			basisNum = ball.basisNum;
+			center = ball.center;
+			radius2 = ball.radius2;
 		}
+		FarthestPoint(pos, size, center, maxDist2);
 
+		Sphere sphere;
+		sphere.center = center;
+		sphere.radius = std::sqrt(maxDist2);		// whatever the rounding, every point is inside
 		return sphere;
 	}
 
+	// a Ritter style guess from the extreme spheres, then the center walks toward the farthest sphere with a
+	// shrinking step (Badoiu-Clarkson), keeping the smallest ball seen. Near minimal, never smaller than needed.
 	Sphere Sphere::FromSpheres(const std::vector<Sphere>& spheres, uint32_t size) {
-		std::vector<uint32_t> minIdx(3);
-		std::vector<uint32_t> maxIdx(3);
-		for (auto i = 0; i < size; i++) {
-			for (auto k = 0; k < 3; k++) {
+		uint32_t minIdx[3] = { 0, 0, 0 };
+		uint32_t maxIdx[3] = { 0, 0, 0 };
+		for (uint32_t i = 0; i < size; i++) {
+			for (uint32_t k = 0; k < 3; k++) {
 				if (spheres[i].center[k] - spheres[i].radius < spheres[minIdx[k]].center[k] - spheres[minIdx[k]].radius)
 					minIdx[k] = i;
-				if (spheres[i].center[k] + spheres[i].radius < spheres[maxIdx[k]].center[k] + spheres[maxIdx[k]].radius)
+				if (spheres[i].center[k] + spheres[i].radius > spheres[maxIdx[k]].center[k] + spheres[maxIdx[k]].radius)
 					maxIdx[k] = i;
 			}
 		}
 
 		float maxLen = 0;
 		uint32_t maxAxis = 0;
-		for (auto k = 0; k < 3; k++) {
+		for (uint32_t k = 0; k < 3; k++) {
 			Sphere sMin = spheres[minIdx[k]];
 			Sphere sMax = spheres[maxIdx[k]];
 			float len = glm::length(sMax.center - sMin.center) + sMax.radius + sMin.radius;
@@ -101,9 +210,89 @@ namespace Core {
 		Sphere sphere = spheres[minIdx[maxAxis]];
 		sphere = sphere + spheres[maxIdx[maxAxis]];
 
-		for (auto i = 0; i < size; i++) {
+		for (uint32_t i = 0; i < size; i++) {
 			sphere = sphere + spheres[i];
 		}
+
+		auto farthest = [&](const glm::vec3& center, uint32_t& farIdx) {
+			float radius = 0;
+			for (uint32_t i = 0; i < size; i++) {
+				float r = glm::length(spheres[i].center - center) + spheres[i].radius;
+				if (r > radius) {
+					radius = r;
+					farIdx = i;
+				}
+			}
+			return radius;
+		};
+
+		glm::vec3 center = sphere.center;
+		for (uint32_t iter = 1; iter <= 16; iter++) {
+			uint32_t farIdx = 0;
+			float radius = farthest(center, farIdx);
+			if (radius < sphere.radius) sphere = { center, radius };
+
+			glm::vec3 dir = spheres[farIdx].center - center;
+			float len = glm::length(dir);
+			glm::vec3 farPoint = spheres[farIdx].center + (len > 0 ? dir / len : glm::vec3(0)) * spheres[farIdx].radius;
+			center += (farPoint - center) / float(iter + 1);
+		}
 		return sphere;
 	}
+
+	bool Cone::IsBackFacing(const glm::vec3& viewPoint) const {
+		return cutoff < 1.f && glm::dot(glm::normalize(apex - viewPoint), axis) >= cutoff;
+	}
+
+	Cone Cone::FromTriangles(const glm::vec3* verts, const uint32_t* indices, uint32_t indexNum, const glm::vec3& center) {
+		Cone cone = { center, glm::vec3(0), 1.f };
+
+		// the triangles of a cluster fit on the stack, only bigger inputs allocate.
+		const uint32_t stackTriangleNum = 128;
+		glm::vec3 stackNormals[stackTriangleNum], stackCorners[stackTriangleNum];
+		std::vector<glm::vec3> heapNormals, heapCorners;
+		glm::vec3* normals = stackNormals;
+		glm::vec3* corners = stackCorners;
+		if (indexNum / 3 > stackTriangleNum) {
+			heapNormals.resize(indexNum / 3);
+			heapCorners.resize(indexNum / 3);
+			normals = heapNormals.data();
+			corners = heapCorners.data();
+		}
+
+		uint32_t normalNum = 0;
+		for (uint32_t i = 0; i + 2 < indexNum; i += 3) {
+			glm::vec3 p0 = verts[indices[i]];
+			glm::vec3 normal = glm::cross(verts[indices[i + 1]] - p0, verts[indices[i + 2]] - p0);
+			float len = glm::length(normal);
+			if (len == 0) continue;		// degenerated triangles are never seen
+			normals[normalNum] = normal / len;
+			corners[normalNum] = p0;
+			normalNum++;
+		}
+		if (normalNum == 0) return cone;
+
+		// the axis through the bounding sphere of the normals, then the widest normal from it.
+		glm::vec3 axis = Sphere::FromPoints(normals, normalNum).center;
+		float axisLen = glm::length(axis);
+		if (axisLen < 1e-6f) return cone;
+		axis /= axisLen;
+
+		float minDot = 1.f;
+		for (uint32_t i = 0; i < normalNum; i++) minDot = std::min(minDot, glm::dot(axis, normals[i]));
+		if (minDot <= 0.1f) return cone;		// wider than ~84 degrees, almost always has some face toward the viewer
+
+		// move the apex back along the axis until it is behind the plane of every triangle, then any view
+		// direction toward it within 90 degrees of all the normals sees only back faces.
+		float maxT = 0;
+		for (uint32_t i = 0; i < normalNum; i++) {
+			float t = glm::dot(center - corners[i], normals[i]) / glm::dot(axis, normals[i]);
+			maxT = std::max(maxT, t);
+		}
+
+		cone.apex = center - axis * maxT;
+		cone.axis = axis;
+		cone.cutoff = std::sqrt(1.f - minDot * minDot);
+		return cone;
+	}
 }
\ No newline at end of file
@@ -20,7 +20,19 @@ namespace Core {
 		float radius;
 
 		Sphere operator+(const Sphere& other);
-		static Sphere FromPoints(const std::vector<glm::vec3>& pos, uint32_t size);
+		static Sphere FromPoints(const glm::vec3* pos, uint32_t size);
 		static Sphere FromSpheres(const std::vector<Sphere>& spheres, uint32_t size);
 	};
+
+	// the normals of the triangles lie within a cone around axis, seen from any point p with
+	// dot(normalize(apex - p), axis) >= cutoff all of them face away. cutoff 1 with a zero axis : never back facing.
+	struct Cone {
+		glm::vec3 apex;
+		glm::vec3 axis;
+		float cutoff;
+
+		bool IsBackFacing(const glm::vec3& viewPoint) const;
+		// counter clockwise triangles face front, center is any point near them, the apex is placed from it.
+		static Cone FromTriangles(const glm::vec3* verts, const uint32_t* indices, uint32_t indexNum, const glm::vec3& center);
+	};
 }
\ No newline at end of file
@@ -0,0 +1,206 @@
+#include "BuildCache.h"
+#include "ClusterIO.h"
+
+#include <filesystem>
+#include <fstream>
+
+namespace Core {
+	// bump when the output of BuildParentClusters or the file layout changes, old entries are ignored then.
+	static const uint32_t groupCacheVersion = 4;
+	static const uint32_t checkpointVersion = 5;
+
+	static const uint32_t groupCacheMagic = 0x43475643;		// "CVGC"
+	static const uint32_t checkpointMagic = 0x4b434d56;		// "VMCK"
+
+	template <typename T, typename Allocator>
+	static uint64_t HashArray(const std::vector<T, Allocator>& values, uint64_t seed) {
+		return Util::HashTable::Murmur64(values.data(), values.size() * sizeof(T), seed);
+	}
+
+	template <typename T>
+	static uint64_t HashPod(const T& value, uint64_t seed) {
+		return Util::HashTable::Murmur64(&value, sizeof(T), seed);
+	}
+
+	// write next to the target and rename, so a crash never leaves a truncated file behind.
+	template <typename Writer>
+	static bool CommitFile(const std::string& fileName, Writer&& write) {
+		std::string tmpFileName = fileName + ".tmp";
+		{
+			std::ofstream out(tmpFileName, std::ios::binary);
+			write(out);
+			if (!out) return false;
+		}
+		std::error_code error;
+		std::filesystem::rename(tmpFileName, fileName, error);
+		return !error;
+	}
+
+	GroupCache::GroupCache(const std::string& directory) : _directory(directory) {
+		if (IsEnabled()) std::filesystem::create_directories(_directory);
+	}
+
+	std::string GroupCache::GetFileName(uint64_t key) const {
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.grp", (unsigned long long)key);
+		return (std::filesystem::path(_directory) / name).string();
+	}
+
+	// field by field, the padding of the struct is not initialized.
+	static uint64_t HashPartitionConfig(const PartitionConfig& config, uint64_t seed) {
+		uint64_t hash = HashPod(config.strategy, seed);
+		hash = HashPod(config.isLengthWeighted, hash);
+		return HashPod(config.proximityLinkNum, hash);
+	}
+
+	static uint64_t HashSimplifierConfig(const SimplifierConfig& config, uint64_t seed) {
+		uint64_t hash = HashPod(config.core, seed);
+		return HashPod(config.isLazy, hash);
+	}
+
+	uint64_t GroupCache::HashGroup(const ClusterGroup& clusterGroup, const std::vector<Cluster>& clusters, const PartitionConfig& config,
+		const SimplifierConfig& simplifierConfig) {
+		uint64_t hash = HashPod(groupCacheVersion, 0);
+		hash = HashPartitionConfig(config, hash);
+		hash = HashSimplifierConfig(simplifierConfig, hash);
+		hash = HashPod(clusterGroup.mipLevel, hash);
+
+		for (uint32_t clusterId : clusterGroup.clusters) {
+			const auto& cluster = clusters[clusterId];
+			hash = HashArray(cluster.verts, hash);
+			hash = HashArray(cluster.indices, hash);
+			hash = HashPod(cluster.lodBounds, hash);
+			hash = HashPod(cluster.lodError, hash);
+		}
+
+		// locked edges by position, the cluster ids they come from do not matter.
+		for (auto [clusterId, edgeId] : clusterGroup.externalEdges) {
+			const auto& vertices = clusters[clusterId].verts;
+			const auto& indices = clusters[clusterId].indices;
+			hash = HashPod(vertices[indices[edgeId]], hash);
+			hash = HashPod(vertices[indices[Util::Cycle3(edgeId)]], hash);
+		}
+		return hash;
+	}
+
+	bool GroupCache::Load(uint64_t key, ClusterGroup& clusterGroup, std::vector<Cluster>& parentClusters) const {
+		std::ifstream in(GetFileName(key), std::ios::binary);
+		if (!in) return false;
+
+		uint32_t magic = 0, version = 0, clusterNum = 0;
+		uint64_t fileKey = 0;
+		Sphere lodBounds;
+		float maxParentLodError;
+		in.read((char*)&magic, sizeof(magic));
+		in.read((char*)&version, sizeof(version));
+		in.read((char*)&fileKey, sizeof(fileKey));
+		in.read((char*)&lodBounds, sizeof(lodBounds));
+		in.read((char*)&maxParentLodError, sizeof(maxParentLodError));
+		in.read((char*)&clusterNum, sizeof(clusterNum));
+		if (!in || magic != groupCacheMagic || version != groupCacheVersion || fileKey != key) return false;
+
+		std::vector<Cluster> result(clusterNum);
+		for (auto& cluster : result) {
+			if (!ClusterIO::ReadCluster(in, cluster)) return false;
+		}
+
+		clusterGroup.lodBounds = lodBounds;
+		clusterGroup.maxParentLodError = maxParentLodError;
+		parentClusters = std::move(result);
+		return true;
+	}
+
+	void GroupCache::Store(uint64_t key, const ClusterGroup& clusterGroup, const std::vector<Cluster>& parentClusters) const {
+		auto write = [&](std::ostream& out) {
+			uint32_t clusterNum = parentClusters.size();
+			out.write((const char*)&groupCacheMagic, sizeof(groupCacheMagic));
+			out.write((const char*)&groupCacheVersion, sizeof(groupCacheVersion));
+			out.write((const char*)&key, sizeof(key));
+			out.write((const char*)&clusterGroup.lodBounds, sizeof(clusterGroup.lodBounds));
+			out.write((const char*)&clusterGroup.maxParentLodError, sizeof(clusterGroup.maxParentLodError));
+			out.write((const char*)&clusterNum, sizeof(clusterNum));
+			for (const auto& cluster : parentClusters) {
+				ClusterIO::WriteCluster(out, cluster);
+			}
+		};
+
+		if (!CommitFile(GetFileName(key), write)) {
+			std::cerr << "Warning: fail to store group cache " << GetFileName(key) << "\n";
+		}
+	}
+
+	// ----------------------------------------------------------------------------------
+
+	LevelCheckpoint::LevelCheckpoint(const std::string& directory) : _directory(directory) {
+		if (IsEnabled()) std::filesystem::create_directories(_directory);
+	}
+
+	std::string LevelCheckpoint::GetFileName() const {
+		return (std::filesystem::path(_directory) / "vmesh.ckpt").string();
+	}
+
+	uint64_t LevelCheckpoint::HashMesh(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, const PartitionConfig& config,
+		const SimplifierConfig& simplifierConfig, const WeldConfig& weldConfig) {
+		uint64_t hash = HashPod(checkpointVersion, 0);
+		hash = HashPod(groupCacheVersion, hash);
+		hash = HashPartitionConfig(config, hash);
+		hash = HashSimplifierConfig(simplifierConfig, hash);
+		hash = HashPod(weldConfig.epsilon, hash);
+		hash = HashArray(vertices, hash);
+		hash = HashArray(indices, hash);
+		return hash;
+	}
+
+	bool LevelCheckpoint::Load(uint64_t meshHash, std::vector<Cluster>& clusters, std::vector<ClusterGroup>& clusterGroups, LevelState& state) const {
+		std::ifstream in(GetFileName(), std::ios::binary);
+		if (!in) return false;
+
+		uint32_t magic = 0, version = 0, clusterNum = 0, groupNum = 0;
+		uint64_t fileHash = 0;
+		LevelState fileState;
+		in.read((char*)&magic, sizeof(magic));
+		in.read((char*)&version, sizeof(version));
+		in.read((char*)&fileHash, sizeof(fileHash));
+		in.read((char*)&fileState, sizeof(fileState));
+		in.read((char*)&clusterNum, sizeof(clusterNum));
+		in.read((char*)&groupNum, sizeof(groupNum));
+		if (!in || magic != checkpointMagic || version != checkpointVersion || fileHash != meshHash) return false;
+
+		std::vector<Cluster> resultClusters(clusterNum);
+		std::vector<ClusterGroup> resultGroups(groupNum);
+		for (auto& cluster : resultClusters) {
+			if (!ClusterIO::ReadCluster(in, cluster)) return false;
+		}
+		for (auto& clusterGroup : resultGroups) {
+			if (!ClusterIO::ReadClusterGroup(in, clusterGroup)) return false;
+		}
+
+		clusters = std::move(resultClusters);
+		clusterGroups = std::move(resultGroups);
+		state = fileState;
+		return true;
+	}
+
+	void LevelCheckpoint::Save(uint64_t meshHash, const std::vector<Cluster>& clusters, const std::vector<ClusterGroup>& clusterGroups, const LevelState& state) const {
+		auto write = [&](std::ostream& out) {
+			uint32_t clusterNum = clusters.size();
+			uint32_t groupNum = clusterGroups.size();
+			out.write((const char*)&checkpointMagic, sizeof(checkpointMagic));
+			out.write((const char*)&checkpointVersion, sizeof(checkpointVersion));
+			out.write((const char*)&meshHash, sizeof(meshHash));
+			out.write((const char*)&state, sizeof(state));
+			out.write((const char*)&clusterNum, sizeof(clusterNum));
+			out.write((const char*)&groupNum, sizeof(groupNum));
+			for (const auto& cluster : clusters) {
+				ClusterIO::WriteCluster(out, cluster);
+			}
+			for (const auto& clusterGroup : clusterGroups) {
+				ClusterIO::WriteClusterGroup(out, clusterGroup);
+			}
+		};
+
+		if (!CommitFile(GetFileName(), write)) {
+			std::cerr << "Warning: fail to save checkpoint " << GetFileName() << "\n";
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Cluster.h"
+#include "Weld.h"
+
+#include <string>
+#include <vector>
+
+namespace Core {
+	// where the DAG loop is, enough to continue it.
+	struct LevelState {
+		uint32_t levelOffset = 0;		// first cluster of the current level
+		uint32_t mipLevel = 0;
+		uint32_t maxGroupSize = ClusterGroup::maxClusterGroupSize;		// doubles each time a level does not shrink
+		bool isBorderLocked = true;		// open mesh borders, unlocked by the first level that does not shrink
+	};
+
+	// content-addressed store of BuildParentClusters results, one file per group.
+	class GroupCache final {
+	public:
+		GroupCache(const std::string& directory);
+
+		bool IsEnabled() const { return !_directory.empty(); }
+
+		// key of everything the parent clusters depend on : the input clusters in order, the locked edges, the partitioning and the simplifier.
+		static uint64_t HashGroup(const ClusterGroup& clusterGroup, const std::vector<Cluster>& clusters, const PartitionConfig& config,
+			const SimplifierConfig& simplifierConfig);
+
+		bool Load(uint64_t key, ClusterGroup& clusterGroup, std::vector<Cluster>& parentClusters) const;
+		void Store(uint64_t key, const ClusterGroup& clusterGroup, const std::vector<Cluster>& parentClusters) const;
+
+	private:
+		std::string _directory;
+
+		std::string GetFileName(uint64_t key) const;
+	};
+
+	// snapshot of the DAG written after every level, so an interrupted build can resume.
+	class LevelCheckpoint final {
+	public:
+		LevelCheckpoint(const std::string& directory);
+
+		bool IsEnabled() const { return !_directory.empty(); }
+
+		static uint64_t HashMesh(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, const PartitionConfig& config,
+			const SimplifierConfig& simplifierConfig, const WeldConfig& weldConfig);
+
+		bool Load(uint64_t meshHash, std::vector<Cluster>& clusters, std::vector<ClusterGroup>& clusterGroups, LevelState& state) const;
+		void Save(uint64_t meshHash, const std::vector<Cluster>& clusters, const std::vector<ClusterGroup>& clusterGroups, const LevelState& state) const;
+
+	private:
+		std::string _directory;
+
+		std::string GetFileName() const;
+	};
+}
@@ -0,0 +1,195 @@
+#include "BuildReport.h"
+#include "HashTable.h"
+#include "VirtualMesh.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace Core {
+	void BuildReport::Collect(const VirtualMesh& vmesh, BuildReport& report) {
+		std::vector<ClusterSummary> clusters;
+		std::vector<GroupSummary> groups;
+		clusters.reserve(vmesh.GetClusters().size());
+		groups.reserve(vmesh.GetClusterGroups().size());
+
+		for (const auto& cluster : vmesh.GetClusters()) {
+			clusters.push_back({ cluster.mipLevel, uint32_t(cluster.indices.size() / 3), uint32_t(cluster.verts.size()),
+				cluster.lodError, cluster.sphereBounds.radius, cluster.boxBounds });
+		}
+		for (const auto& group : vmesh.GetClusterGroups()) {
+			groups.push_back({ group.mipLevel, uint32_t(group.clusters.size()), group.bounds.radius });
+		}
+		Collect(clusters, groups, report);
+		report.stageMemory = vmesh.GetStageMemory();
+		report.partitionQuality = vmesh.GetPartitionQuality();
+	}
+
+	void BuildReport::Collect(const std::vector<ClusterSummary>& clusters, const std::vector<GroupSummary>& groups, BuildReport& report) {
+		report = BuildReport();
+		report.clusterNum = clusters.size();
+		report.groupNum = groups.size();
+
+		uint32_t levelNum = 0;
+		for (const auto& cluster : clusters) levelNum = std::max(levelNum, cluster.mipLevel + 1);
+		report.levels.resize(levelNum);
+		for (uint32_t i = 0; i < levelNum; i++) report.levels[i].mipLevel = i;
+
+		auto& sections = report.sections;
+		sections.headerBytes = PackedLayout::headerWords * sizeof(uint32_t);
+		sections.clusterRecordBytes = uint64_t(PackedLayout::clusterWords) * sizeof(uint32_t) * clusters.size();
+		sections.groupRecordBytes = uint64_t(PackedLayout::groupWords) * sizeof(uint32_t) * groups.size();
+
+		for (const auto& cluster : clusters) {
+			auto& level = report.levels[cluster.mipLevel];
+			if (level.clusterNum == 0) {
+				level.minLodError = level.maxLodError = cluster.lodError;
+			}
+			level.clusterNum++;
+			level.triangleNum += cluster.triangleNum;
+			level.vertexNum += cluster.vertexNum;
+			if (cluster.triangleNum < Cluster::clusterSize) level.underfilledClusterNum++;
+			level.minLodError = std::min(level.minLodError, cluster.lodError);
+			level.maxLodError = std::max(level.maxLodError, cluster.lodError);
+
+			float boxExtent = glm::length(cluster.boxBounds.pMax - cluster.boxBounds.pMin) * 0.5f;
+			level.avgSphereRadius += cluster.sphereRadius;
+			level.avgBoxExtent += boxExtent;
+			level.avgRadiusToExtent += boxExtent > 0 ? cluster.sphereRadius / boxExtent : 1.f;
+
+			sections.vertexBytes += uint64_t(cluster.vertexNum) * 3 * sizeof(uint32_t);
+			sections.triangleBytes += uint64_t(cluster.triangleNum) * sizeof(uint32_t);
+		}
+
+		for (const auto& group : groups) {
+			if (group.mipLevel >= levelNum) continue;
+			auto& level = report.levels[group.mipLevel];
+			if (level.groupNum == 0) {
+				level.minGroupSize = level.maxGroupSize = group.clusterNum;
+			}
+			level.groupNum++;
+			level.avgGroupRadius += group.sphereRadius;
+			level.minGroupSize = std::min(level.minGroupSize, group.clusterNum);
+			level.maxGroupSize = std::max(level.maxGroupSize, group.clusterNum);
+			if (level.groupSizeHistogram.size() <= group.clusterNum) level.groupSizeHistogram.resize(group.clusterNum + 1);
+			level.groupSizeHistogram[group.clusterNum]++;
+
+			sections.groupClusterListBytes += uint64_t(group.clusterNum) * sizeof(uint32_t);
+		}
+
+		for (uint32_t i = 0; i < levelNum; i++) {
+			auto& level = report.levels[i];
+			if (level.clusterNum) {
+				level.avgSphereRadius /= level.clusterNum;
+				level.avgBoxExtent /= level.clusterNum;
+				level.avgRadiusToExtent /= level.clusterNum;
+			}
+			if (level.groupNum) {
+				level.avgGroupRadius /= level.groupNum;
+			}
+			if (i > 0 && report.levels[i - 1].triangleNum) {
+				level.reductionRatio = float(level.triangleNum) / report.levels[i - 1].triangleNum;
+			}
+		}
+
+		sections.totalBytes = sections.headerBytes + sections.clusterRecordBytes + sections.groupRecordBytes
+			+ sections.vertexBytes + sections.triangleBytes + sections.groupClusterListBytes;
+	}
+
+	uint64_t BuildReport::Fingerprint(const std::vector<uint32_t>& packedData) {
+		return Util::HashTable::Murmur64(packedData.data(), packedData.size() * sizeof(uint32_t));
+	}
+
+	std::string BuildReport::FormatFingerprint(uint64_t fingerprint) {
+		char text[17];
+		snprintf(text, sizeof(text), "%016llx", (unsigned long long)fingerprint);
+		return text;
+	}
+
+	std::string BuildReport::ToJson() const {
+		std::ostringstream out;
+		out << "{\n";
+		out << "  \"clusterNum\": " << clusterNum << ",\n";
+		out << "  \"groupNum\": " << groupNum << ",\n";
+		out << "  \"mipLevelNum\": " << levels.size() << ",\n";
+		if (fingerprint) {
+			out << "  \"fingerprint\": \"" << FormatFingerprint(fingerprint) << "\",\n";
+		}
+
+		out << "  \"sections\": {\n";
+		out << "    \"headerBytes\": " << sections.headerBytes << ",\n";
+		out << "    \"clusterRecordBytes\": " << sections.clusterRecordBytes << ",\n";
+		out << "    \"groupRecordBytes\": " << sections.groupRecordBytes << ",\n";
+		out << "    \"vertexBytes\": " << sections.vertexBytes << ",\n";
+		out << "    \"triangleBytes\": " << sections.triangleBytes << ",\n";
+		out << "    \"groupClusterListBytes\": " << sections.groupClusterListBytes << ",\n";
+		out << "    \"totalBytes\": " << sections.totalBytes << "\n";
+		out << "  },\n";
+
+		if (!stageMemory.empty()) {
+			out << "  \"stageMemory\": [";
+			for (size_t i = 0; i < stageMemory.size(); i++) {
+				const auto& peak = stageMemory[i].peak;
+				out << (i ? ",\n" : "\n") << "    { \"stage\": \"" << stageMemory[i].stage << "\", \"milliseconds\": " << stageMemory[i].milliseconds
+					<< ", \"peakBytes\": " << peak.total;
+				for (uint32_t tag = 0; tag < (uint32_t)Util::MemoryTag::Count; tag++) {
+					out << ", \"" << Util::ToString(Util::MemoryTag(tag)) << "\": " << peak.tags[tag];
+				}
+				out << " }";
+			}
+			out << "\n  ],\n";
+		}
+
+		if (!partitionQuality.empty()) {
+			out << "  \"partitionQuality\": [";
+			for (size_t i = 0; i < partitionQuality.size(); i++) {
+				const auto& quality = partitionQuality[i];
+				out << (i ? ",\n" : "\n") << "    { \"strategy\": \"" << quality.strategy << "\", \"isLengthWeighted\": " << (quality.isLengthWeighted ? "true" : "false")
+					<< ", \"proximityLinkNum\": " << quality.proximityLinkNum << ", \"partNum\": " << quality.partNum
+					<< ", \"underfilledPartNum\": " << quality.underfilledPartNum << ", \"edgeCut\": " << quality.edgeCut
+					<< ", \"milliseconds\": " << quality.milliseconds << ", \"avgClusterRadius\": " << quality.avgClusterRadius
+					<< ", \"groupNum\": " << quality.groupNum << ", \"avgGroupRadius\": " << quality.avgGroupRadius << " }";
+			}
+			out << "\n  ],\n";
+		}
+
+		out << "  \"levels\": [";
+		for (size_t i = 0; i < levels.size(); i++) {
+			const auto& level = levels[i];
+			out << (i ? ",\n" : "\n") << "    {\n";
+			out << "      \"mipLevel\": " << level.mipLevel << ",\n";
+			out << "      \"clusterNum\": " << level.clusterNum << ",\n";
+			out << "      \"triangleNum\": " << level.triangleNum << ",\n";
+			out << "      \"vertexNum\": " << level.vertexNum << ",\n";
+			out << "      \"underfilledClusterNum\": " << level.underfilledClusterNum << ",\n";
+			out << "      \"avgTrianglesPerCluster\": " << (level.clusterNum ? float(level.triangleNum) / level.clusterNum : 0.f) << ",\n";
+			out << "      \"reductionRatio\": " << level.reductionRatio << ",\n";
+			out << "      \"lodError\": [" << level.minLodError << ", " << level.maxLodError << "],\n";
+			out << "      \"avgSphereRadius\": " << level.avgSphereRadius << ",\n";
+			out << "      \"avgBoxExtent\": " << level.avgBoxExtent << ",\n";
+			out << "      \"avgRadiusToExtent\": " << level.avgRadiusToExtent << ",\n";
+			out << "      \"groupNum\": " << level.groupNum << ",\n";
+			out << "      \"avgGroupRadius\": " << level.avgGroupRadius << ",\n";
+			out << "      \"groupSize\": [" << level.minGroupSize << ", " << level.maxGroupSize << "],\n";
+			out << "      \"groupSizeHistogram\": {";
+			bool isFirst = true;
+			for (size_t size = 0; size < level.groupSizeHistogram.size(); size++) {
+				if (!level.groupSizeHistogram[size]) continue;
+				out << (isFirst ? "" : ", ") << "\"" << size << "\": " << level.groupSizeHistogram[size];
+				isFirst = false;
+			}
+			out << "}\n";
+			out << "    }";
+		}
+		out << "\n  ]\n";
+		out << "}\n";
+		return out.str();
+	}
+
+	bool BuildReport::WriteJson(const std::string& fileName) const {
+		std::ofstream out(fileName);
+		out << ToJson();
+		return static_cast<bool>(out);
+	}
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "Bound.h"
+#include "MemoryTracker.h"
+
+#include <string>
+#include <vector>
+
+namespace Core {
+	class VirtualMesh;
+
+	// word layout of the packed data written by VirtualMesh::Pack.
+	struct PackedLayout {
+		static const uint32_t headerWords = 4;		// cluster num, group num, group data offset, format
+		// 'VM' and the layout version in the last header word, bumped whenever a record changes; data of another
+		// format is rejected on load, so stale packed files are rebuilt instead of misread.
+		static const uint32_t format = 0x564d0000 | 2;
+		static const uint32_t clusterWords = 36;
+		static const uint32_t groupWords = 8;
+
+		// word offsets inside a cluster record; bounds are center xyz and radius, the cone apex is followed by its cutoff.
+		static const uint32_t clusterVertexNum = 0, clusterVertexOffset = 1, clusterTriangleNum = 2, clusterTriangleOffset = 3;
+		static const uint32_t clusterSphereBounds = 4, clusterLodBounds = 8, clusterParentLodBounds = 12;
+		static const uint32_t clusterLodError = 16, clusterMaxParentLodError = 17, clusterGroupId = 18, clusterMipLevel = 19;
+		static const uint32_t clusterConeApex = 20, clusterConeAxis = 24, clusterBoxMin = 28, clusterBoxMax = 32;
+		// and inside a group record.
+		static const uint32_t groupClusterNum = 0, groupClusterOffset = 1, groupMaxParentLodError = 2, groupLodBounds = 4;
+	};
+
+	struct LevelStats {
+		uint32_t mipLevel = 0;
+		uint32_t clusterNum = 0;
+		uint32_t triangleNum = 0;
+		uint32_t vertexNum = 0;
+		uint32_t underfilledClusterNum = 0;		// clusters with less than Cluster::clusterSize triangles
+		float reductionRatio = 1.f;				// triangles of this level / triangles of the previous level
+		float minLodError = 0.f;
+		float maxLodError = 0.f;
+		float avgSphereRadius = 0.f;
+		float avgBoxExtent = 0.f;				// half diagonal of the AABB
+		float avgRadiusToExtent = 0.f;			// 1 means the sphere is as tight as the box allows
+
+		uint32_t groupNum = 0;					// groups built from this level
+		float avgGroupRadius = 0.f;				// of the bounding spheres of the groups
+		uint32_t minGroupSize = 0;
+		uint32_t maxGroupSize = 0;
+		std::vector<uint32_t> groupSizeHistogram;	// [size] = group num
+	};
+
+	struct SectionStats {
+		uint64_t headerBytes = 0;
+		uint64_t clusterRecordBytes = 0;
+		uint64_t groupRecordBytes = 0;
+		uint64_t vertexBytes = 0;
+		uint64_t triangleBytes = 0;
+		uint64_t groupClusterListBytes = 0;
+		uint64_t totalBytes = 0;
+	};
+
+	// peak tracked memory and wall time of one build stage. the peak is process wide, anything allocated beside the build counts too.
+	struct StageMemory {
+		std::string stage;
+		Util::MemoryUsage peak;
+		double milliseconds = 0;		// since the previous stage ended
+	};
+
+	// how one partition config splits the triangles and the clusters of the base level.
+	struct PartitionQuality {
+		std::string strategy;
+		bool isLengthWeighted = false;
+		uint32_t proximityLinkNum = 0;
+		uint32_t partNum = 0;
+		uint32_t underfilledPartNum = 0;		// parts with less than Cluster::clusterSize - 4 triangles
+		uint64_t edgeCut = 0;					// triangle adjacencies split between parts
+		double milliseconds = 0;				// of the triangle partition
+		float avgClusterRadius = 0.f;
+		uint32_t groupNum = 0;					// groups of the base level clusters of the build
+		float avgGroupRadius = 0.f;
+	};
+
+	// statistics of a cluster DAG, either from a VirtualMesh or from packed data.
+	class BuildReport final {
+	public:
+		struct ClusterSummary {
+			uint32_t mipLevel;
+			uint32_t triangleNum;
+			uint32_t vertexNum;
+			float lodError;
+			float sphereRadius;
+			Bounds boxBounds;
+		};
+
+		struct GroupSummary {
+			uint32_t mipLevel;
+			uint32_t clusterNum;
+			float sphereRadius;
+		};
+
+		std::vector<LevelStats> levels;
+		SectionStats sections;
+		std::vector<StageMemory> stageMemory;		// only known right after a build
+		std::vector<PartitionQuality> partitionQuality;		// the build config against plain METIS bisection, idem
+		uint32_t clusterNum = 0;
+		uint32_t groupNum = 0;
+		uint64_t fingerprint = 0;		// of the packed data, 0 : not packed
+
+		static void Collect(const VirtualMesh& vmesh, BuildReport& report);
+		static void Collect(const std::vector<ClusterSummary>& clusters, const std::vector<GroupSummary>& groups, BuildReport& report);
+
+		// 64 bit hash of the packed words; builds of one mesh and config give the same one for any thread num.
+		static uint64_t Fingerprint(const std::vector<uint32_t>& packedData);
+		static std::string FormatFingerprint(uint64_t fingerprint);		// 16 hex digits
+
+		std::string ToJson() const;
+		bool WriteJson(const std::string& fileName) const;
+	};
+}
@@ -1,31 +1,180 @@
 #include "Cluster.h"
-#include <unordered_map>
+#include "RadixSort.h"
+#include <algorithm>
+#include <optional>
 
 namespace Core {
-	void Cluster::BuildClusters(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, std::vector<Cluster>& clusters) {
+	// weight of a shared edge of mean length, proximity links weigh 1 so they only decide when nothing else does.
+	static const float meanEdgeCost = 8.f;
+	// proximity links reach at most this many times the mean distance between adjacent elements.
+	static const float proximityDistanceScale = 2.f;
+
+	static void GetTriangleCentroids(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, PartitionerVector<glm::vec3>& centroids,
+		Util::Scheduler* scheduler = nullptr) {
+		centroids.resize(indices.size() / 3);
+		Util::ForEachChunk(scheduler, centroids.size(), [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				centroids[i] = (vertices[indices[i * 3]] + vertices[indices[i * 3 + 1]] + vertices[indices[i * 3 + 2]]) / 3.f;
+			}
+		});
+	}
+
+	// lengths to weights, scaled so that the mean length weighs meanEdgeCost.
+	static void LengthsToCosts(const PartitionerVector<float>& lengths, PartitionerVector<int32_t>& costs, Util::Scheduler* scheduler = nullptr) {
+		double lengthSum = Util::ParallelReduce(scheduler, lengths.size(), 0.0, [&](uint32_t begin, uint32_t end) {
+			double sum = 0;
+			for (uint32_t i = begin; i < end; i++) sum += lengths[i];
+			return sum;
+		}, std::plus<double>());
+		float scale = lengthSum > 0 ? float(meanEdgeCost * lengths.size() / lengthSum) : 0.f;
+
+		costs.resize(lengths.size());
+		Util::ForEachChunk(scheduler, lengths.size(), [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				costs[i] = std::max(1, int32_t(lengths[i] * scale + 0.5f));
+			}
+		});
+	}
+
+	// links each node to up to linkNum of the closest nodes it has no edge to. The candidates are its neighbours along the
+	// Morton order, which keeps it linear; pieces that share no edge with anything near them are joined this way.
+	static void AddProximityLinks(Graph& graph, std::span<const glm::vec3> positions, uint32_t linkNum) {
+		const uint32_t nodeNum = graph.GetNodeNum();
+		if (nodeNum < 2 || linkNum == 0) return;
+
+		double adjacentDistance = 0;
+		for (uint32_t i = 0; i < nodeNum; i++) {
+			for (auto to : graph.GetEdges(i)) adjacentDistance += glm::distance(positions[i], positions[to]);
+		}
+		if (graph.GetEdgeNum() == 0) return;
+		float maxDistance = float(proximityDistanceScale * adjacentDistance / graph.GetEdgeNum());
+
+		PartitionerVector<uint64_t> mortonKeys;
+		SortByMortonCode(positions, mortonKeys);
+
+		const uint32_t window = 4 * linkNum;
+		PartitionerVector<std::pair<uint32_t, uint32_t>> links;
+		PartitionerVector<std::pair<float, uint32_t>> candidates;
+		for (uint32_t rank = 0; rank < nodeNum; rank++) {
+			uint32_t node = uint32_t(mortonKeys[rank]);
+			auto edges = graph.GetEdges(node);
+
+			candidates.clear();
+			for (uint32_t other = rank > window ? rank - window : 0; other < std::min(nodeNum, rank + window + 1); other++) {
+				uint32_t to = uint32_t(mortonKeys[other]);
+				if (to == node || std::binary_search(edges.begin(), edges.end(), int32_t(to))) continue;
+				float distance = glm::distance(positions[node], positions[to]);
+				if (distance <= maxDistance) candidates.push_back({ distance, to });
+			}
+
+			uint32_t candidateNum = std::min<uint32_t>(linkNum, candidates.size());
+			std::partial_sort(candidates.begin(), candidates.begin() + candidateNum, candidates.end());
+			for (uint32_t i = 0; i < candidateNum; i++) {
+				links.push_back({ node, candidates[i].second });
+				links.push_back({ candidates[i].second, node });
+			}
+		}
+		if (links.empty()) return;
+		std::sort(links.begin(), links.end());
+		links.erase(std::unique(links.begin(), links.end()), links.end());
+
+		Graph linkedGraph;
+		linkedGraph.Init(nodeNum, graph.GetEdgeNum() + links.size());
+		uint32_t link = 0;
+		for (uint32_t i = 0; i < nodeNum; i++) {
+			for (int32_t j = graph.GetXadj()[i]; j < graph.GetXadj()[i + 1]; j++) {
+				linkedGraph.AddEdge(graph.GetAdjncy()[j], graph.GetAdjwgt()[j]);
+			}
+			for (; link < links.size() && links[link].first == i; link++) {
+				linkedGraph.AddEdge(links[link].second, 1);
+			}
+			linkedGraph.FinishNode();
+		}
+		graph = std::move(linkedGraph);
+	}
+
+	void Cluster::PartitionTriangles(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, const Graph& graph,
+		Partitioner& partitioner, Util::Scheduler* scheduler) {
+		PartitionerVector<glm::vec3> centroids;
+		if (partitioner.GetStrategy() == PartitionStrategy::Spatial) {
+			GetTriangleCentroids(vertices, indices, centroids, scheduler);
+			partitioner.SetNodePositions(centroids);
+		}
+		partitioner.Partition(graph, Cluster::clusterSize - 4, Cluster::clusterSize, scheduler);
+	}
+
+	void Cluster::BuildTriangleGraph(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, const PartitionConfig& config, Graph& edgeLink, Graph& graph,
+		Util::Scheduler* scheduler, EdgeLinkScratch* scratch) {
+		// edge costs and centroids do not need the edge link, so on a scheduler they overlap with it.
+		PartitionerVector<int32_t> edgeCosts;
+		PartitionerVector<glm::vec3> centroids;
+		auto buildEdgeLink = [&] { BuildAdjacentEdgeLink(vertices, indices, edgeLink, scheduler, scratch); };
+		auto buildEdgeCosts = [&] {
+			if (!config.isLengthWeighted) return;
+			PartitionerVector<float> lengths(indices.size());
+			Util::ForEachChunk(scheduler, indices.size(), [&](uint32_t begin, uint32_t end) {
+				for (uint32_t i = begin; i < end; i++) {
+					lengths[i] = glm::distance(vertices[indices[i]], vertices[indices[Util::Cycle3(i)]]);
+				}
+			});
+			LengthsToCosts(lengths, edgeCosts, scheduler);
+		};
+		auto buildCentroids = [&] {
+			if (config.proximityLinkNum) GetTriangleCentroids(vertices, indices, centroids, scheduler);
+		};
+		auto buildGraph = [&] { BuildAdjacentGraph(edgeLink, graph, edgeCosts); };
+		auto addProximityLinks = [&] {
+			if (config.proximityLinkNum) AddProximityLinks(graph, centroids, config.proximityLinkNum);
+		};
+
+		if (!scheduler) {
+			buildEdgeLink();
+			buildEdgeCosts();
+			buildCentroids();
+			buildGraph();
+			addProximityLinks();
+			return;
+		}
+		Util::TaskGraph taskGraph;
+		uint32_t edgeLinkTask = taskGraph.Add(buildEdgeLink);
+		uint32_t edgeCostsTask = taskGraph.Add(buildEdgeCosts);
+		uint32_t centroidsTask = taskGraph.Add(buildCentroids);
+		uint32_t graphTask = taskGraph.Add(buildGraph, { edgeLinkTask, edgeCostsTask });
+		taskGraph.Add(addProximityLinks, { graphTask, centroidsTask });
+		taskGraph.Run(*scheduler);
+	}
+
+	void Cluster::BuildClusters(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, std::vector<Cluster>& clusters, Util::Scheduler* scheduler,
+		const PartitionConfig& config) {
 		Graph edgeLink, graph;
-		BuildAdjacentEdgeLink(vertices, indices, edgeLink);
-		BuildAdjacentGraph(edgeLink, graph);
+		BuildTriangleGraph(vertices, indices, config, edgeLink, graph, scheduler);
 
-		Partitioner partitioner;
-		partitioner.Partition(graph, Cluster::clusterSize - 4, Cluster::clusterSize);
+		Partitioner partitioner(config.strategy);
+		PartitionTriangles(vertices, indices, graph, partitioner, scheduler);
 
-		for (auto [left, right] : partitioner.GetRanges()) {
-			Cluster cluster;
+		// clusters are independent once the partition is known, each thread reuses its own vertex map.
+		const auto& ranges = partitioner.GetRanges();
+		std::vector<Cluster> newClusters(ranges.size());
+		Util::PerThread<ClusterVertexMap> vertexMaps(scheduler);
+		auto buildCluster = [&](uint32_t rangeId) {
+			auto [left, right] = ranges[rangeId];
+			auto& cluster = newClusters[rangeId];
+			auto& mp = vertexMaps.Get();
+			mp.Clear();
 
-			std::unordered_map<uint32_t, uint32_t> mp;
 			for (uint32_t i = left; i < right; i++) {
 				uint32_t triangleId = partitioner.GetNodeId(i);
 				for (uint32_t k = 0; k < 3; k++) {
 					uint32_t edgeId = triangleId * 3 + k;
 					uint32_t vertId = indices[edgeId];
-					if (mp.find(vertId) == mp.end()) {
-						mp[vertId] = cluster.verts.size();
+					uint32_t& localId = mp.FindOrAdd(vertId);
+					if (localId == ~0u) {
+						localId = cluster.verts.size();
 						cluster.verts.push_back(vertices[vertId]);
 					}
 					bool isExternal = false;
-					bool hasOpposedEdge = edgeLink.GetGraph()[edgeId].size() != 0;
-					for (auto [adjEdge, _] : edgeLink.GetGraph()[edgeId]) {
+					bool hasOpposedEdge = !edgeLink.GetEdges(edgeId).empty();
+					for (auto adjEdge : edgeLink.GetEdges(edgeId)) {
 						uint32_t adjTriangle = partitioner.GetSortTo(adjEdge / 3);
 						if (adjTriangle < left || adjTriangle >= right) {
 							isExternal = true;
@@ -36,56 +185,100 @@ namespace Core {
 					if (isExternal) {
 						cluster.externalEdges.push_back(cluster.indices.size());
 					}
-					cluster.indices.push_back(mp[vertId]);
+					cluster.indices.push_back(localId);
 				}
 			}
 
 			cluster.mipLevel = 0;
 			cluster.lodError = 0;
-			cluster.sphereBounds = Sphere::FromPoints(cluster.verts, cluster.verts.size());
+			cluster.sphereBounds = Sphere::FromPoints(cluster.verts.data(), cluster.verts.size());
+			cluster.normalCone = Cone::FromTriangles(cluster.verts.data(), cluster.indices.data(), cluster.indices.size(), cluster.sphereBounds.center);
 			cluster.lodBounds = cluster.sphereBounds;
 			cluster.boxBounds = cluster.verts[0];
 			cluster.groupId = 0;
 			for (auto v : cluster.verts) cluster.boxBounds = cluster.boxBounds + v;
+		};
+		if (scheduler) scheduler->ParallelFor(ranges.size(), buildCluster);
+		else for (uint32_t i = 0; i < ranges.size(); i++) buildCluster(i);
 
-			clusters.push_back(cluster);
-		}
+		clusters.reserve(clusters.size() + newClusters.size());
+		for (auto& cluster : newClusters) clusters.push_back(std::move(cluster));
 	}
 
-	void Cluster::BuildAdjacentEdgeLink(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, Graph& edgeLink) {
-		Util::HashTable edgeHashTable(indices.size());
-		edgeLink.Init(indices.size());
-
-		for (size_t forwardId = 0; forwardId < indices.size(); forwardId++) {
-			glm::vec3 v0 = vertices[indices[forwardId]];
-			glm::vec3 v1 = vertices[indices[Util::Cycle3(forwardId)]];
-
-			auto hash0 = Util::HashTable::HashValue(v0);
-			auto hash1 = Util::HashTable::HashValue(v1);
-			edgeHashTable.Add(Util::HashTable::Murmur32({ hash0, hash1 }), forwardId);
-
-			for (auto backId = edgeHashTable.First(Util::HashTable::Murmur32({ hash1, hash0 })); edgeHashTable.IsValid(backId); backId = edgeHashTable.Next(backId)) {
-				if (v1 == vertices[indices[backId]] && v0 == vertices[indices[Util::Cycle3(backId)]]) {
-					edgeLink.IncreaseEdgeCost(forwardId, backId, 1);
-					edgeLink.IncreaseEdgeCost(backId, forwardId, 1);
-				}
+	// links every directed edge to the edges running the other way between the same positions. Edges are keyed by
+	// the position hashes of their two ends, smaller first, and radix sorted, so an edge and its opposite edges end up
+	// in one run of equal keys; the exact positions only have to be compared inside a run. Both passes over the runs
+	// are per edge and write only its own row, so they split freely across the scheduler, and the rows come out
+	// sorted since the sort is stable. getEnds(edge) : the start and end position of an edge.
+	// scratch : reused buffers, nullptr : buffers of this call, the sort buffer is freed as soon as the sort is done.
+	template <typename GetEnds>
+	static void MatchOppositeEdges(uint32_t edgeNum, GetEnds&& getEnds, Graph& edgeLink, Util::Scheduler* scheduler, EdgeLinkScratch* scratch) {
+		EdgeLinkScratch localScratch;		// empty vectors, nothing is allocated unless it is used
+		auto& buffers = scratch ? *scratch : localScratch;
+		auto& items = buffers.items;
+		items.resize(edgeNum);
+		Util::ForEachChunk(scheduler, edgeNum, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				auto [v0, v1] = getEnds(i);
+				uint32_t hash0 = Util::HashTable::HashValue(v0), hash1 = Util::HashTable::HashValue(v1);
+				items[i] = { { std::max(hash0, hash1), std::min(hash0, hash1) }, i };
 			}
-		}
+		});
+		Util::RadixSort(items, buffers.sortItems, scheduler);
+		if (!scratch) PartitionerVector<Util::RadixItem<2>>().swap(buffers.sortItems);
+
+		auto isSameKey = [&](uint32_t a, uint32_t b) { return items[a].words[0] == items[b].words[0] && items[a].words[1] == items[b].words[1]; };
+		// calls func with each opposite edge of the edge at sorted position i, in ascending order.
+		auto forEachOpposite = [&](uint32_t i, auto&& func) {
+			uint32_t begin = i, end = i + 1;
+			while (begin > 0 && isSameKey(begin - 1, i)) begin--;
+			while (end < edgeNum && isSameKey(end, i)) end++;
+			auto [v0, v1] = getEnds(items[i].value);
+			for (uint32_t j = begin; j < end; j++) {
+				auto [w0, w1] = getEnds(items[j].value);
+				if (w0 == v1 && w1 == v0) func(items[j].value);
+			}
+		};
+
+		auto& rowSizes = buffers.rowSizes;
+		rowSizes.assign(edgeNum, 0);
+		Util::ForEachChunk(scheduler, edgeNum, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) forEachOpposite(i, [&](uint32_t) { rowSizes[items[i].value]++; });
+		});
+		edgeLink.InitRows(rowSizes);
+		Util::ForEachChunk(scheduler, edgeNum, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++) {
+				uint32_t slot = 0;
+				forEachOpposite(i, [&](uint32_t backId) { edgeLink.SetEdge(items[i].value, slot++, backId, 1); });
+			}
+		});
 	}
 
-	void Cluster::BuildAdjacentGraph(const Graph& edgeLink, Graph& graph) {
-		graph.Init(edgeLink.GetGraph().size() / 3);		// triangle's nums;
-		uint32_t edge0 = 0;
-		for (const auto& mp : edgeLink.GetGraph()) {
-			for (auto [edge1, cost] : mp) {
-				graph.IncreaseEdgeCost(edge0 / 3, edge1 / 3, 1);
+	void Cluster::BuildAdjacentEdgeLink(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, Graph& edgeLink,
+		Util::Scheduler* scheduler, EdgeLinkScratch* scratch) {
+		MatchOppositeEdges(indices.size(), [&](uint32_t edgeId) {
+			return std::pair<const glm::vec3&, const glm::vec3&>(vertices[indices[edgeId]], vertices[indices[Util::Cycle3(edgeId)]]);
+		}, edgeLink, scheduler, scratch);
+	}
+
+	void Cluster::BuildAdjacentGraph(const Graph& edgeLink, Graph& graph, std::span<const int32_t> edgeCosts) {
+		uint32_t triangleNum = edgeLink.GetNodeNum() / 3;
+		graph.Init(triangleNum, edgeLink.GetEdgeNum());
+		for (uint32_t triangleId = 0; triangleId < triangleNum; triangleId++) {
+			for (uint32_t k = 0; k < 3; k++) {
+				uint32_t edge0 = triangleId * 3 + k;
+				for (auto edge1 : edgeLink.GetEdges(edge0)) {
+					graph.AddEdge(edge1 / 3, edgeCosts.empty() ? 1 : edgeCosts[edge0]);
+				}
 			}
-			edge0++;
+			graph.FinishNode();
 		}
 	}
 
 
-	void ClusterGroup::BuildClusterGroups(std::vector<Cluster>& clusters, uint32_t offset, uint32_t clusterNum, uint32_t mipLevel, std::vector<ClusterGroup>& clusterGroups) {
+	void ClusterGroup::BuildClusterGroups(std::vector<Cluster>& clusters, uint32_t offset, uint32_t clusterNum, uint32_t mipLevel, std::vector<ClusterGroup>& clusterGroups,
+		const PartitionConfig& config, uint32_t maxGroupSize, bool isBorderLocked, Util::Scheduler* scheduler,
+		const std::function<bool(const glm::vec3&, const glm::vec3&)>& isSeam) {
 		std::span<const Cluster> clustersView(clusters.begin() + offset, clusterNum);
 
 		std::vector<uint32_t> edge2Cluster;
@@ -94,7 +287,7 @@ namespace Core {
 
 		uint32_t clusterId = 0;
 		for (auto& cluster : clustersView) {
-			assert(cluster.mipLevel == mipLevel);
+			assert(cluster.mipLevel <= mipLevel);		// streaming builds merge chunk tops of different levels
 			cluster2Edge.push_back(edge2Cluster.size());
 
 			for (auto edgeId : cluster.externalEdges) {
@@ -105,11 +298,33 @@ namespace Core {
 		}
 
 		Graph edgeLink, graph;
-		BuildClustersEdgeLink(clustersView, externalEdges, edgeLink);
-		BuildClustersGraph(edgeLink, edge2Cluster, clusterNum, graph);
+		BuildClustersEdgeLink(clustersView, externalEdges, edgeLink, scheduler);
+
+		PartitionerVector<int32_t> edgeCosts;
+		if (config.isLengthWeighted) {
+			PartitionerVector<float> lengths(externalEdges.size());
+			for (uint32_t i = 0; i < externalEdges.size(); i++) {
+				auto [clusterId, edgeId] = externalEdges[i];
+				const auto& cluster = clustersView[clusterId];
+				lengths[i] = glm::distance(cluster.verts[cluster.indices[edgeId]], cluster.verts[cluster.indices[Util::Cycle3(edgeId)]]);
+			}
+			LengthsToCosts(lengths, edgeCosts);
+		}
+		BuildClustersGraph(edgeLink, edge2Cluster, clusterNum, graph, edgeCosts);
+
+		PartitionerVector<glm::vec3> centers;
+		if (config.strategy == PartitionStrategy::Spatial || config.proximityLinkNum) {
+			for (auto& cluster : clustersView) centers.push_back(cluster.sphereBounds.center);
+		}
+		if (config.proximityLinkNum) {
+			AddProximityLinks(graph, centers, config.proximityLinkNum);
+		}
 
-		Partitioner partitioner;
-		partitioner.Partition(graph, ClusterGroup::maxClusterGroupSize - 4, ClusterGroup::maxClusterGroupSize);
+		Partitioner partitioner(config.strategy);
+		if (config.strategy == PartitionStrategy::Spatial) {
+			partitioner.SetNodePositions(centers);
+		}
+		partitioner.Partition(graph, maxGroupSize - 4, maxGroupSize);
 
 
 		
@@ -117,6 +332,12 @@ namespace Core {
 			ClusterGroup clusterGroup;
 			clusterGroup.mipLevel = mipLevel;
 
+			std::vector<Sphere> spheres;
+			for (auto i = left; i < right; i++) {
+				spheres.push_back(clustersView[partitioner.GetNodeId(i)].sphereBounds);
+			}
+			clusterGroup.bounds = Sphere::FromSpheres(spheres, spheres.size());
+
 			for (auto i = left; i < right; i++) {
 				uint32_t clusterId = partitioner.GetNodeId(i);
 				//clusters[clusterId + offset].groupId = clusterGroups.size();
@@ -124,15 +345,20 @@ namespace Core {
 
 				for (uint32_t edgeId = cluster2Edge[clusterId]; edgeId < edge2Cluster.size() && edge2Cluster[edgeId] == clusterId; edgeId++) {
 					bool isExternal = false;
-					bool hasOpposedEdge = edgeLink.GetGraph()[edgeId].size() != 0;
-					for (auto [adj, _] : edgeLink.GetGraph()[edgeId]) {
+					bool hasOpposedEdge = !edgeLink.GetEdges(edgeId).empty();
+					for (auto adj : edgeLink.GetEdges(edgeId)) {
 						auto adjCluster = partitioner.GetSortTo(edge2Cluster[adj]);
 						if (adjCluster < left || adjCluster >= right) {
 							isExternal = true;
 							break;
 						}
 					}
-					if (!hasOpposedEdge) isExternal = true;
+					if (!hasOpposedEdge) {
+						const auto& cluster = clustersView[clusterId];
+						uint32_t realEdgeId = externalEdges[edgeId].second;
+						isExternal = isBorderLocked
+							|| (isSeam && isSeam(cluster.verts[cluster.indices[realEdgeId]], cluster.verts[cluster.indices[Util::Cycle3(realEdgeId)]]));
+					}
 					if (isExternal) {
 						uint32_t realEdgeId = externalEdges[edgeId].second;
 						clusterGroup.externalEdges.push_back(std::pair{ clusterId + offset, realEdgeId});
@@ -145,16 +371,35 @@ namespace Core {
 
 	
 
-	void ClusterGroup::BuildParentClusters(uint32_t groupId, ClusterGroup& clusterGroup, std::vector<Cluster>& clusters) {
-		std::vector<glm::vec3> vertices;
-		std::vector<uint32_t> indices;
-		std::vector<Sphere> lodBounds;
+	void ClusterGroup::BuildParentClusters(uint32_t groupId, ClusterGroup& clusterGroup, std::vector<Cluster>& clusters, const PartitionConfig& config,
+		const SimplifierConfig& simplifierConfig) {
+		std::vector<Cluster> parentClusters;
+		BuildParentClusters(clusterGroup, clusters, parentClusters, config, simplifierConfig);
+
+		for (uint32_t clusterId : clusterGroup.clusters) {
+			clusters[clusterId].groupId = groupId;
+		}
+		for (auto& cluster : parentClusters) {
+			cluster.groupId = groupId + 1;
+			clusters.push_back(std::move(cluster));
+		}
+	}
+
+	void ClusterGroup::BuildParentClusters(ClusterGroup& clusterGroup, const std::vector<Cluster>& clusters, std::vector<Cluster>& parentClusters,
+		const PartitionConfig& config, const SimplifierConfig& simplifierConfig, Util::Scheduler* scheduler, ParentClusterScratch* buildScratch) {
+		std::optional<ParentClusterScratch> localScratch;
+		auto& scratch = buildScratch ? *buildScratch : localScratch.emplace();
+		auto& vertices = scratch.vertices;
+		auto& indices = scratch.indices;
+		auto& lodBounds = scratch.lodBounds;
+		vertices.clear();
+		indices.clear();
+		lodBounds.clear();
 		float maxParentLodError = 0;
 		uint32_t idOffset = 0;
 
 		for (uint32_t clusterId : clusterGroup.clusters) {
-			auto& cluster = clusters[clusterId];
-			cluster.groupId = groupId;
+			const auto& cluster = clusters[clusterId];
 			for (const auto& v : cluster.verts) vertices.push_back(v);
 			for (const auto& id : cluster.indices) indices.push_back(id + idOffset);
 			idOffset += cluster.verts.size();
@@ -163,9 +408,11 @@ namespace Core {
 		}
 		Sphere parentLodBound = Sphere::FromSpheres(lodBounds, lodBounds.size());
 
-		MeshSimplifier meshSimplifier(vertices.data(), vertices.size(), indices.data(), indices.size());
+		auto& meshSimplifier = scratch.meshSimplifier;
+		meshSimplifier.Reset(vertices.data(), vertices.size(), indices.data(), indices.size(), simplifierConfig);
 
-		Util::HashTable edgeHashTable(clusterGroup.externalEdges.size());
+		auto& edgeHashTable = scratch.edgeHashTable;
+		edgeHashTable.Reset(clusterGroup.externalEdges.size());
 
 		uint32_t i = 0;
 		for (auto [clusterId, edgeId] : clusterGroup.externalEdges) {
@@ -184,34 +431,44 @@ namespace Core {
 
 			i++;
 		}
-		meshSimplifier.Simplify((Cluster::clusterSize - 2) * (clusterGroup.clusters.size() / 2));
+		meshSimplifier.Simplify(TargetTriangleNum(clusterGroup.clusters.size(), indices.size() / 3), scheduler);
 		vertices.resize(meshSimplifier.RemainingVertNum());
 		indices.resize(meshSimplifier.RemainingTriangleNum() * 3);
 
 		maxParentLodError = std::max(maxParentLodError, std::sqrt(meshSimplifier.MaxError()));
+		clusterGroup.lodBounds = parentLodBound;
+		clusterGroup.maxParentLodError = maxParentLodError;
+		// nothing left to partition, the group has no parents and its clusters stay the top of the DAG.
+		if (indices.empty()) return;
 
-		Graph edgeLink, graph;
-		Cluster::BuildAdjacentEdgeLink(vertices, indices, edgeLink);
-		Cluster::BuildAdjacentGraph(edgeLink, graph);
+		auto& edgeLink = scratch.edgeLink;
+		auto& graph = scratch.graph;
+		Cluster::BuildTriangleGraph(vertices, indices, config, edgeLink, graph, nullptr, &scratch.edgeLinkScratch);
 
-		Partitioner partitioner;
-		partitioner.Partition(graph, Cluster::clusterSize - 4, Cluster::clusterSize);
+		auto& partitioner = scratch.partitioner;
+		partitioner.SetStrategy(config.strategy);
+		Cluster::PartitionTriangles(vertices, indices, graph, partitioner);
 
 		for (auto [left, right] : partitioner.GetRanges()) {
 			//std::cout << left << " " << right << " " << right - left + 1 << "\n";
-			Cluster cluster;
-			std::unordered_map<uint32_t, uint32_t> mp;
+			auto& cluster = scratch.cluster;
+			cluster.verts.clear();
+			cluster.indices.clear();
+			cluster.externalEdges.clear();
+			auto& mp = scratch.vertexMap;
+			mp.Clear();
 			for (uint32_t i = left; i < right; i++) {
 				uint32_t triangleId = partitioner.GetNodeId(i);
 				for (uint32_t k = 0; k < 3; k++) {
 					uint32_t edgeId = triangleId * 3 + k;
 					uint32_t vertId = indices[edgeId];
-					if (mp.find(vertId) == mp.end()) {
-						mp[vertId] = cluster.verts.size();
+					uint32_t& localId = mp.FindOrAdd(vertId);
+					if (localId == ~0u) {
+						localId = cluster.verts.size();
 						cluster.verts.push_back(vertices[vertId]);
 					}
 					bool isExternal = false;
-					for (auto [adjEdge, _] : edgeLink.GetGraph()[edgeId]) {
+					for (auto adjEdge : edgeLink.GetEdges(edgeId)) {
 						uint32_t adjTriangle = partitioner.GetSortTo(adjEdge / 3);
 						if (adjTriangle < left || adjTriangle >= right) {
 							isExternal = true;
@@ -239,63 +496,48 @@ namespace Core {
 					if (isExternal) {
 						cluster.externalEdges.push_back(cluster.indices.size());
 					}
-					cluster.indices.push_back(mp[vertId]);
+					cluster.indices.push_back(localId);
 				}
 			}
 
 			cluster.mipLevel = clusterGroup.mipLevel + 1;
 			cluster.lodError = maxParentLodError;
-			cluster.sphereBounds = Sphere::FromPoints(cluster.verts, cluster.verts.size());
+			cluster.sphereBounds = Sphere::FromPoints(cluster.verts.data(), cluster.verts.size());
+			cluster.normalCone = Cone::FromTriangles(cluster.verts.data(), cluster.indices.data(), cluster.indices.size(), cluster.sphereBounds.center);
 			cluster.lodBounds = parentLodBound;
 			cluster.boxBounds = cluster.verts[0];
-			cluster.groupId = groupId + 1;
+			cluster.groupId = 0;		// assigned when merged into the cluster array
 			for (auto v : cluster.verts) cluster.boxBounds = cluster.boxBounds + v;
 
-			clusters.push_back(cluster);
+			parentClusters.push_back(cluster);
 		}
-		clusterGroup.lodBounds = parentLodBound;
-		clusterGroup.maxParentLodError = maxParentLodError;
 	}
 
-	void ClusterGroup::BuildClustersEdgeLink(std::span<const Cluster> clusters, const std::vector<std::pair<uint32_t, uint32_t>>& externalEdges, Graph& edgeLink) {
-		Util::HashTable edgeHashTable(externalEdges.size());
-		edgeLink.Init(externalEdges.size());
-
-		uint32_t forwardId = 0;
-		for (auto [clusterId, edgeId] : externalEdges) {
-
-			auto& vertices = clusters[clusterId].verts;
-			auto& indices = clusters[clusterId].indices;
-
-			const glm::vec3& v0 = vertices[indices[edgeId]];
-			const glm::vec3& v1 = vertices[indices[Util::Cycle3(edgeId)]];
-
-			auto hash0 = Util::HashTable::HashValue(v0);
-			auto hash1 = Util::HashTable::HashValue(v1);
-			edgeHashTable.Add(Util::HashTable::Murmur32({ hash0, hash1 }), forwardId);
-
-			for (auto backId = edgeHashTable.First(Util::HashTable::Murmur32({ hash1, hash0 })); edgeHashTable.IsValid(backId); backId = edgeHashTable.Next(backId)) {
-				auto [clusterId2, edgeId2] = externalEdges[backId];
-				auto& vertices2 = clusters[clusterId2].verts;
-				auto& indices2 = clusters[clusterId2].indices;
+	uint32_t ClusterGroup::TargetTriangleNum(uint32_t clusterNum, uint32_t triangleNum) {
+		return std::max(1u, std::min((Cluster::clusterSize - 2) * std::max(1u, clusterNum / 2), triangleNum / 2));
+	}
 
-				if (vertices2[indices2[edgeId2]] == v1 && vertices2[indices2[Util::Cycle3(edgeId2)]] == v0) {
-					edgeLink.IncreaseEdgeCost(forwardId, backId, 1);
-					edgeLink.IncreaseEdgeCost(backId, forwardId, 1);
-				}
-			}
-			forwardId++;
-		}
+	void ClusterGroup::BuildClustersEdgeLink(std::span<const Cluster> clusters, const std::vector<std::pair<uint32_t, uint32_t>>& externalEdges, Graph& edgeLink,
+		Util::Scheduler* scheduler) {
+		MatchOppositeEdges(externalEdges.size(), [&](uint32_t i) {
+			auto [clusterId, edgeId] = externalEdges[i];
+			const auto& cluster = clusters[clusterId];
+			return std::pair<const glm::vec3&, const glm::vec3&>(cluster.verts[cluster.indices[edgeId]], cluster.verts[cluster.indices[Util::Cycle3(edgeId)]]);
+		}, edgeLink, scheduler, nullptr);
 	}
 
-	void ClusterGroup::BuildClustersGraph(const Graph& edgeLink, const std::vector<uint32_t>& edge2Cluster, uint32_t clusterNum, Graph& graph) {
-		graph.Init(clusterNum);		// triangle's nums;
+	void ClusterGroup::BuildClustersGraph(const Graph& edgeLink, const std::vector<uint32_t>& edge2Cluster, uint32_t clusterNum, Graph& graph,
+		std::span<const int32_t> edgeCosts) {
+		// the external edges are listed cluster by cluster, so the rows come out in order.
+		graph.Init(clusterNum, edgeLink.GetEdgeNum());
 		uint32_t edge0 = 0;
-		for (const auto& mp : edgeLink.GetGraph()) {
-			for (auto [edge1, cost] : mp) {
-				graph.IncreaseEdgeCost(edge2Cluster[edge0], edge2Cluster[edge1], 1);
+		for (uint32_t clusterId = 0; clusterId < clusterNum; clusterId++) {
+			for (; edge0 < edge2Cluster.size() && edge2Cluster[edge0] == clusterId; edge0++) {
+				for (auto edge1 : edgeLink.GetEdges(edge0)) {
+					graph.AddEdge(edge2Cluster[edge1], edgeCosts.empty() ? 1 : edgeCosts[edge0]);
+				}
 			}
-			edge0++;
+			graph.FinishNode();
 		}
 	}
 }
\ No newline at end of file
@@ -3,33 +3,110 @@
 #include "Bound.h"
 #include "Partitioner.h"
 #include "HashTable.h"
+#include "MemoryTracker.h"
+#include "RadixSort.h"
 #include "Util.h"
 
 #include "MeshSimplifier.h"
 
+#include <functional>
 #include <vector>
 #include <glm/glm.hpp>
 #include <span>
 
 namespace Core {
+	// how the triangles of clusters and the clusters of groups are partitioned.
+	struct PartitionConfig {
+		PartitionStrategy strategy = PartitionStrategy::Bisection;
+		bool isLengthWeighted = false;		// a shared edge weighs by its length against the mean one instead of 1
+		uint32_t proximityLinkNum = 0;		// links from each element to the closest ones it shares no edge with, 0 : off
+	};
+
+	// buffers of an edge link that keep their capacity from call to call.
+	struct EdgeLinkScratch {
+		PartitionerVector<Util::RadixItem<2>> items;
+		PartitionerVector<Util::RadixItem<2>> sortItems;
+		PartitionerVector<uint32_t> rowSizes;
+	};
+
 	class Cluster final {
 	public:
 		static const uint32_t clusterSize = 128;
 
-		std::vector<glm::vec3> verts;
-		std::vector<uint32_t> indices;
-		std::vector<uint32_t> externalEdges;
+		Util::TrackedVector<glm::vec3, Util::MemoryTag::Cluster> verts;
+		Util::TrackedVector<uint32_t, Util::MemoryTag::Cluster> indices;
+		Util::TrackedVector<uint32_t, Util::MemoryTag::Cluster> externalEdges;
 
 		Bounds boxBounds;
 		Sphere sphereBounds;
 		Sphere lodBounds;
+		Cone normalCone;
 		float lodError;
 		uint32_t mipLevel;
 		uint32_t groupId;
 
-		static void BuildClusters(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, std::vector<Cluster>& clusters);
-		static void BuildAdjacentEdgeLink(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, Graph& edgeLink);
-		static void BuildAdjacentGraph(const Graph& edgeLink, Graph& graph);
+		static void BuildClusters(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, std::vector<Cluster>& clusters, Util::Scheduler* scheduler = nullptr,
+			const PartitionConfig& config = {});
+		// scratch : reused buffers owned by the caller, nullptr : buffers of this call only.
+		static void BuildAdjacentEdgeLink(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, Graph& edgeLink,
+			Util::Scheduler* scheduler = nullptr, EdgeLinkScratch* scratch = nullptr);
+		// edgeCosts : the weight of each edge (corner) id, empty : 1 for all.
+		static void BuildAdjacentGraph(const Graph& edgeLink, Graph& graph, std::span<const int32_t> edgeCosts = {});
+		// the edge link and the graph of the triangles, weighted and linked as config asks.
+		// scratch : for the edge link, length weights and proximity links still allocate their own buffers.
+		static void BuildTriangleGraph(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, const PartitionConfig& config, Graph& edgeLink, Graph& graph,
+			Util::Scheduler* scheduler = nullptr, EdgeLinkScratch* scratch = nullptr);
+		// into parts of clusterSize triangles, the spatial strategy places each triangle at its centroid.
+		static void PartitionTriangles(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, const Graph& graph,
+			Partitioner& partitioner, Util::Scheduler* scheduler = nullptr);
+	};
+
+	// mesh vertex ids to the ids of one cluster, open addressing over enough slots for the 3 * clusterSize corners.
+	// Clear only resets the slots in use, so a map per thread serves all of its clusters without allocating.
+	class ClusterVertexMap final {
+	public:
+		ClusterVertexMap() : _keys(slotNum, ~0u), _values(slotNum) {}
+
+		void Clear() {
+			for (uint32_t slot : _usedSlots) _keys[slot] = ~0u;
+			_usedSlots.clear();
+		}
+
+		// the cluster id of vertId, ~0u if it was not in the map.
+		uint32_t& FindOrAdd(uint32_t vertId) {
+			uint32_t slot = (vertId * 2654435761u) >> (32 - slotBits);
+			while (_keys[slot] != vertId && _keys[slot] != ~0u) slot = (slot + 1) & (slotNum - 1);
+			if (_keys[slot] == ~0u) {
+				_keys[slot] = vertId;
+				_values[slot] = ~0u;
+				_usedSlots.push_back(slot);
+			}
+			return _values[slot];
+		}
+
+	private:
+		static const uint32_t slotBits = 10;
+		static const uint32_t slotNum = 1u << slotBits;
+		static_assert(slotNum >= Cluster::clusterSize * 3 * 2);
+		std::vector<uint32_t> _keys;
+		std::vector<uint32_t> _values;
+		std::vector<uint32_t> _usedSlots;
+	};
+
+	// buffers of BuildParentClusters that keep their capacity from group to group, one set per thread of a build.
+	// Once they have grown, a group with the default partition config allocates only the buffers of its parent clusters.
+	struct ParentClusterScratch {
+		std::vector<glm::vec3> vertices;
+		std::vector<uint32_t> indices;
+		std::vector<Sphere> lodBounds;
+		Util::HashTable edgeHashTable { Util::MemoryTag::Cluster };
+		MeshSimplifier meshSimplifier;
+		EdgeLinkScratch edgeLinkScratch;
+		Graph edgeLink;
+		Graph graph;
+		Partitioner partitioner;
+		ClusterVertexMap vertexMap;
+		Cluster cluster;		// built here, then copied out at its exact size
 	};
 
 	class ClusterGroup final
@@ -39,15 +116,33 @@ namespace Core {
 		static const uint32_t minClusterGroupSize = 8;
 
 		uint32_t mipLevel;
-		std::vector<uint32_t> clusters;
-		std::vector<std::pair<uint32_t, uint32_t>> externalEdges;
+		Util::TrackedVector<uint32_t, Util::MemoryTag::Cluster> clusters;
+		Util::TrackedVector<std::pair<uint32_t, uint32_t>, Util::MemoryTag::Cluster> externalEdges;
 		Sphere bounds;
 		Sphere lodBounds;
 		float maxParentLodError;
 
-		static void BuildClusterGroups(std::vector<Cluster>& clusters, uint32_t offset, uint32_t clusterNum, uint32_t mipLevel, std::vector<ClusterGroup>& clusterGroups);
-		static void BuildParentClusters(uint32_t groupId, ClusterGroup& clusterGroup, std::vector<Cluster>& clusters);
-		static void BuildClustersEdgeLink(std::span<const Cluster> clusters, const std::vector<std::pair<uint32_t, uint32_t>>& externalEdges, Graph& edgeLink);
-		static void BuildClustersGraph(const Graph& edgeLink, const std::vector<uint32_t>& edge2Cluster, uint32_t clusterNum, Graph& graph);
+		// maxGroupSize : grows past maxClusterGroupSize when a level does not shrink, larger groups lock fewer edges.
+		// isBorderLocked : false leaves open mesh borders free to collapse, only edges shared with other groups stay locked.
+		// isSeam : open edges it is true for stay locked all the same, the seams to streaming chunks that are not merged yet.
+		static void BuildClusterGroups(std::vector<Cluster>& clusters, uint32_t offset, uint32_t clusterNum, uint32_t mipLevel, std::vector<ClusterGroup>& clusterGroups,
+			const PartitionConfig& config = {}, uint32_t maxGroupSize = maxClusterGroupSize, bool isBorderLocked = true, Util::Scheduler* scheduler = nullptr,
+			const std::function<bool(const glm::vec3&, const glm::vec3&)>& isSeam = nullptr);
+		// triangles the group simplifies to : half of its clusters, but never more than half of its triangles, so
+		// that underfilled clusters of the top levels still shrink, and at least one.
+		static uint32_t TargetTriangleNum(uint32_t clusterNum, uint32_t triangleNum);
+		static void BuildParentClusters(uint32_t groupId, ClusterGroup& clusterGroup, std::vector<Cluster>& clusters, const PartitionConfig& config = {},
+			const SimplifierConfig& simplifierConfig = {});
+		// simplify and re-partition one group without touching the cluster array, so groups of a level can run concurrently.
+		// scheduler : for the simplification of this one group, never pass it from a task of the same scheduler.
+		// scratch : reused buffers owned by the caller, nullptr : buffers of this call only.
+		static void BuildParentClusters(ClusterGroup& clusterGroup, const std::vector<Cluster>& clusters, std::vector<Cluster>& parentClusters,
+			const PartitionConfig& config = {}, const SimplifierConfig& simplifierConfig = {}, Util::Scheduler* scheduler = nullptr,
+			ParentClusterScratch* scratch = nullptr);
+		static void BuildClustersEdgeLink(std::span<const Cluster> clusters, const std::vector<std::pair<uint32_t, uint32_t>>& externalEdges, Graph& edgeLink,
+			Util::Scheduler* scheduler = nullptr);
+		// edgeCosts : the weight of each external edge, empty : 1 for all.
+		static void BuildClustersGraph(const Graph& edgeLink, const std::vector<uint32_t>& edge2Cluster, uint32_t clusterNum, Graph& graph,
+			std::span<const int32_t> edgeCosts = {});
 	};
 }
\ No newline at end of file
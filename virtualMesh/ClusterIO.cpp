@@ -0,0 +1,75 @@
+#include "ClusterIO.h"
+
+namespace Core {
+	template <typename T>
+	static void WritePod(std::ostream& out, const T& value) {
+		out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	static void ReadPod(std::istream& in, T& value) {
+		in.read(reinterpret_cast<char*>(&value), sizeof(T));
+	}
+
+	template <typename T, typename Allocator>
+	static void WriteArray(std::ostream& out, const std::vector<T, Allocator>& values) {
+		uint32_t size = values.size();
+		WritePod(out, size);
+		out.write(reinterpret_cast<const char*>(values.data()), size * sizeof(T));
+	}
+
+	template <typename T, typename Allocator>
+	static void ReadArray(std::istream& in, std::vector<T, Allocator>& values) {
+		uint32_t size = 0;
+		ReadPod(in, size);
+		if (!in) return;
+		values.resize(size);
+		in.read(reinterpret_cast<char*>(values.data()), size * sizeof(T));
+	}
+
+	void ClusterIO::WriteCluster(std::ostream& out, const Cluster& cluster) {
+		WriteArray(out, cluster.verts);
+		WriteArray(out, cluster.indices);
+		WriteArray(out, cluster.externalEdges);
+		WritePod(out, cluster.boxBounds);
+		WritePod(out, cluster.sphereBounds);
+		WritePod(out, cluster.lodBounds);
+		WritePod(out, cluster.normalCone);
+		WritePod(out, cluster.lodError);
+		WritePod(out, cluster.mipLevel);
+		WritePod(out, cluster.groupId);
+	}
+
+	bool ClusterIO::ReadCluster(std::istream& in, Cluster& cluster) {
+		ReadArray(in, cluster.verts);
+		ReadArray(in, cluster.indices);
+		ReadArray(in, cluster.externalEdges);
+		ReadPod(in, cluster.boxBounds);
+		ReadPod(in, cluster.sphereBounds);
+		ReadPod(in, cluster.lodBounds);
+		ReadPod(in, cluster.normalCone);
+		ReadPod(in, cluster.lodError);
+		ReadPod(in, cluster.mipLevel);
+		ReadPod(in, cluster.groupId);
+		return static_cast<bool>(in);
+	}
+
+	void ClusterIO::WriteClusterGroup(std::ostream& out, const ClusterGroup& clusterGroup) {
+		WritePod(out, clusterGroup.mipLevel);
+		WriteArray(out, clusterGroup.clusters);
+		WriteArray(out, clusterGroup.externalEdges);
+		WritePod(out, clusterGroup.bounds);
+		WritePod(out, clusterGroup.lodBounds);
+		WritePod(out, clusterGroup.maxParentLodError);
+	}
+
+	bool ClusterIO::ReadClusterGroup(std::istream& in, ClusterGroup& clusterGroup) {
+		ReadPod(in, clusterGroup.mipLevel);
+		ReadArray(in, clusterGroup.clusters);
+		ReadArray(in, clusterGroup.externalEdges);
+		ReadPod(in, clusterGroup.bounds);
+		ReadPod(in, clusterGroup.lodBounds);
+		ReadPod(in, clusterGroup.maxParentLodError);
+		return static_cast<bool>(in);
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Cluster.h"
+
+#include <iostream>
+#include <vector>
+
+namespace Core {
+	// raw binary (de)serialization of clusters and groups, used to spill or checkpoint a build.
+	class ClusterIO final {
+	public:
+		static void WriteCluster(std::ostream& out, const Cluster& cluster);
+		static bool ReadCluster(std::istream& in, Cluster& cluster);
+
+		static void WriteClusterGroup(std::ostream& out, const ClusterGroup& clusterGroup);
+		static bool ReadClusterGroup(std::istream& in, ClusterGroup& clusterGroup);
+	};
+}
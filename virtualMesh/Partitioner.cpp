@@ -1,75 +1,148 @@
 #include "Partitioner.h"
+#include "Heap.h"
+#include "Util.h"
 
 #include <metis.h>
 #include <vector>
 #include <algorithm>
+#include <tuple>
 #include <assert.h>
 #include <iostream>
 
 namespace Core {
+	static_assert(sizeof(idx_t) == sizeof(int32_t), "Graph stores its CSR arrays as int32_t for METIS");
+
+	// a subgraph of the bisection, in the input graph or in one of the partitioner buffers.
 	struct MetisGraph {
 		idx_t nvtxs;
-		std::vector<idx_t> xadj;
-		std::vector<idx_t> adjncy;		// ѹͼʾ
-		std::vector<idx_t> adjwgt;		// edge weight
-
+		idx_t* xadj;
+		idx_t* adjncy;		// ѹͼʾ
+		idx_t* adjwgt;		// edge weight
+		uint32_t edgeOffset;	// of adjncy in the whole graph
+		uint32_t buffer;		// the buffer holding it, children go to the other one
 	};
 
+	// subgraphs with fewer nodes are bisected on the current thread, below that a task costs more than it saves.
+	static const idx_t parallelNodeNum = 4096;
+	// sweeps of boundary moves after the k-way call, METIS is close to balanced already so few are needed.
+	static const uint32_t refinePassNum = 4;
+
+	void SortByMortonCode(std::span<const glm::vec3> positions, PartitionerVector<uint64_t>& mortonKeys) {
+		glm::vec3 pMin = positions[0], pMax = positions[0];
+		for (const auto& position : positions) {
+			pMin = glm::min(pMin, position);
+			pMax = glm::max(pMax, position);
+		}
+		glm::vec3 scale = glm::vec3(1023.f) / glm::max(pMax - pMin, glm::vec3(1e-20f));
+
+		// the index in the low bits keeps the order unique, so the result does not depend on the sort.
+		mortonKeys.resize(positions.size());
+		for (uint32_t i = 0; i < positions.size(); i++) {
+			glm::uvec3 cell((positions[i] - pMin) * scale);
+			mortonKeys[i] = (uint64_t(Util::MortonCode(cell.x, cell.y, cell.z)) << 32) | i;
+		}
+		std::sort(mortonKeys.begin(), mortonKeys.end());
+	}
+
+	const char* ToString(PartitionStrategy strategy) {
+		switch (strategy) {
+		case PartitionStrategy::Bisection: return "bisection";
+		case PartitionStrategy::KWay: return "kway";
+		case PartitionStrategy::Spatial: return "spatial";
+		default: return "unknown";
+		}
+	}
+
 	typedef uint32_t u32;
 	typedef int32_t i32;
 
-	MetisGraph* ToMetisData(const Graph& graph) {
-		MetisGraph* mg = new MetisGraph;
-		mg->nvtxs = graph.GetGraph().size();
-		for (auto& mp : graph.GetGraph()) {
-			mg->xadj.push_back(mg->adjncy.size());
-			for (auto [to, cost] : mp) {
-				mg->adjncy.push_back(to);
-				mg->adjwgt.push_back(cost);
+	void Graph::Init(uint32_t nodeNum, uint32_t edgeNum) {
+		_xadj.clear();
+		_adjncy.clear();
+		_adjwgt.clear();
+		_xadj.reserve(nodeNum + 1);
+		_adjncy.reserve(edgeNum);
+		_adjwgt.reserve(edgeNum);
+		_xadj.push_back(0);
+	}
+
+	void Graph::InitRows(std::span<const uint32_t> rowSizes) {
+		_xadj.resize(rowSizes.size() + 1);
+		_xadj[0] = 0;
+		for (uint32_t i = 0; i < rowSizes.size(); i++) _xadj[i + 1] = _xadj[i] + rowSizes[i];
+		_adjncy.assign(_xadj.back(), 0);
+		_adjwgt.assign(_xadj.back(), 0);
+	}
+
+	void Graph::FinishNode() {
+		// rows are short, insertion sort keeps both arrays in step without any allocation.
+		uint32_t begin = _xadj.back(), end = _adjncy.size();
+		for (uint32_t i = begin + 1; i < end; i++) {
+			int32_t to = _adjncy[i], cost = _adjwgt[i];
+			uint32_t j = i;
+			for (; j > begin && _adjncy[j - 1] > to; j--) {
+				_adjncy[j] = _adjncy[j - 1];
+				_adjwgt[j] = _adjwgt[j - 1];
 			}
+			_adjncy[j] = to;
+			_adjwgt[j] = cost;
 		}
-		mg->xadj.push_back(mg->adjncy.size());
-		return mg;
+
+		uint32_t size = begin;
+		for (uint32_t i = begin; i < end; i++) {
+			if (size > begin && _adjncy[size - 1] == _adjncy[i]) {
+				_adjwgt[size - 1] += _adjwgt[i];
+			}
+			else {
+				_adjncy[size] = _adjncy[i];
+				_adjwgt[size] = _adjwgt[i];
+				size++;
+			}
+		}
+		_adjncy.resize(size);
+		_adjwgt.resize(size);
+		_xadj.push_back(size);
 	}
 
-	uint32_t Partitioner::BisectGraph(MetisGraph* graphData, MetisGraph* childGraphs[2], uint32_t start, uint32_t end) {
-		assert(end - start == graphData->nvtxs);
+	uint32_t Partitioner::BisectGraph(const MetisGraph& graphData, MetisGraph* childGraphs, uint32_t start, uint32_t end) {
+		const uint32_t nodeNum = graphData.nvtxs;
+		assert(end - start == nodeNum);
 
-		if (graphData->nvtxs <= _maxPartSize) {
-			_ranges.push_back({ start, end });
+		if (nodeNum <= _maxPartSize) {
+			_isRangeStart[start] = 1;
 			return end;
 		}
 
 		const uint32_t expectPartSize = (_minPartSize + _maxPartSize) / 2;
-		const uint32_t expectNumParts = std::max(2u, (graphData->nvtxs + expectPartSize - 1) / expectPartSize);		// ceiling
+		const uint32_t expectNumParts = std::max(2u, (graphData.nvtxs + expectPartSize - 1) / expectPartSize);		// ceiling
 
-		std::vector<idx_t> swapTo(graphData->nvtxs);
-		std::vector<idx_t> parts(graphData->nvtxs);
+		idx_t* swapTo = _swapTo.data() + start;
+		idx_t* parts = _parts.data() + start;
 
-		idx_t nw = 1, npart = 2, ncut = 0;
+		idx_t nvtxs = graphData.nvtxs, nw = 1, npart = 2, ncut = 0;
 		real_t partWeight[] = {
 			float(expectNumParts >> 1) / expectNumParts,
 			1.0 - float(expectNumParts >> 1) / expectNumParts
 		};
 
 		int result = METIS_PartGraphRecursive(
-			&graphData->nvtxs,			// vertices num
+			&nvtxs,						// vertices num
 			&nw,						// the link-num of each vertex
-			graphData->xadj.data(),		// offset of vertex
-			graphData->adjncy.data(),
+			graphData.xadj,				// offset of vertex
+			graphData.adjncy,
 			nullptr,					// vertices weights
 			nullptr,					// vertices size
-			graphData->adjwgt.data(),	// edges weight
+			graphData.adjwgt,			// edges weight
 			&npart,						// target part's num
 			partWeight,					// partition weight
 			nullptr,
 			nullptr,					// options
 			&ncut,						// edge cut
-			parts.data()
+			parts
 		);
 		assert(result == METIS_OK);
 
-		int32_t left = 0, right = graphData->nvtxs - 1;
+		int32_t left = 0, right = graphData.nvtxs - 1;
 		while (left <= right) {
 			while (left <= right && parts[left] == 0) swapTo[left] = left, left++;
 			while (left <= right && parts[right] == 1) swapTo[right] = right, right--;
@@ -82,58 +155,321 @@ namespace Core {
 
 		int32_t split = left;
 
-		int32_t splitGraphSize[2] = { split, graphData->nvtxs - split };
+		int32_t splitGraphSize[2] = { split, graphData.nvtxs - split };
 		assert(splitGraphSize[0] >= 1 && splitGraphSize[1] >= 1);
 
 		if (splitGraphSize[0] <= _maxPartSize && splitGraphSize[1] <= _maxPartSize) {
-			_ranges.push_back({ start, start + split });
-			_ranges.push_back({ start + split, end });
+			_isRangeStart[start] = 1;
+			_isRangeStart[start + split] = 1;
 		}
 		else {
-			for (uint32_t i = 0; i < 2; i++) {
-				childGraphs[i] = new MetisGraph;
-				childGraphs[i]->adjncy.reserve(graphData->adjncy.size() >> 1);
-				childGraphs[i]->adjwgt.reserve(graphData->adjwgt.size() >> 1);
-				childGraphs[i]->xadj.reserve(splitGraphSize[i] + 1);
-				childGraphs[i]->nvtxs = splitGraphSize[i];
-			}
+			// both children fit in the edges of the parent, the right one starts where the left one ends.
+			uint32_t buffer = graphData.buffer ^ 1;
+			uint32_t edgeNum = 0;
+			for (uint32_t c = 0; c < 2; c++) {
+				const uint32_t offset = c ? splitGraphSize[0] : 0;
+				MetisGraph& child = childGraphs[c];
+				child.nvtxs = splitGraphSize[c];
+				child.buffer = buffer;
+				child.edgeOffset = graphData.edgeOffset + edgeNum;
+				child.xadj = _xadj[buffer].data() + 2 * (start + offset);
+				child.adjncy = _adjncy[buffer].data() + child.edgeOffset;
+				child.adjwgt = _adjwgt[buffer].data() + child.edgeOffset;
 
-			for (uint32_t i = 0; i < graphData->nvtxs; i++) {
-				uint32_t isRightChild = (i >= childGraphs[0]->nvtxs);
-				uint32_t id = swapTo[i];
-				MetisGraph* child = childGraphs[isRightChild];
-				child->xadj.push_back(child->adjncy.size());
-				for (uint32_t j = graphData->xadj[id]; j < graphData->xadj[id + 1]; j++) {
-					idx_t vertId = graphData->adjncy[j];
-					idx_t weight = graphData->adjwgt[j];
-
-					vertId = swapTo[vertId] - (isRightChild ? splitGraphSize[0] : 0);
-
-					if (0 <= vertId && vertId < splitGraphSize[isRightChild]) {
-						child->adjncy.push_back(vertId);
-						child->adjwgt.push_back(weight);
+				uint32_t childEdgeNum = 0;
+				for (idx_t i = 0; i < child.nvtxs; i++) {
+					uint32_t id = swapTo[i + offset];
+					child.xadj[i] = childEdgeNum;
+					for (idx_t j = graphData.xadj[id]; j < graphData.xadj[id + 1]; j++) {
+						idx_t vertId = swapTo[graphData.adjncy[j]] - offset;
+						if (0 <= vertId && vertId < child.nvtxs) {
+							child.adjncy[childEdgeNum] = vertId;
+							child.adjwgt[childEdgeNum] = graphData.adjwgt[j];
+							childEdgeNum++;
+						}
 					}
 				}
+				child.xadj[child.nvtxs] = childEdgeNum;
+				edgeNum += childEdgeNum;
 			}
-
-			childGraphs[0]->xadj.push_back(childGraphs[0]->adjncy.size());
-			childGraphs[1]->xadj.push_back(childGraphs[1]->adjncy.size());
 		}
 
 		return start + split;
 	}
 
-	void Partitioner::RecursiveBisectGraph(MetisGraph* graphData, uint32_t start, uint32_t end) {
-		MetisGraph* childGraph[2] = { 0 };
+	void Partitioner::RecursiveBisectGraph(const MetisGraph& graphData, uint32_t start, uint32_t end) {
+		MetisGraph childGraph[2] = {};
 		uint32_t split = BisectGraph(graphData, childGraph, start, end);
-		delete graphData;
 
-		if (childGraph[0] && childGraph[1]) {
-			RecursiveBisectGraph(childGraph[0], start, split);
-			RecursiveBisectGraph(childGraph[1], split, end);
+		if (childGraph[0].xadj && childGraph[1].xadj) {
+			// the halves touch disjoint node and edge ranges of every buffer, so they can run side by side.
+			if (_scheduler && childGraph[0].nvtxs >= parallelNodeNum && childGraph[1].nvtxs >= parallelNodeNum) {
+				Util::Scheduler::TaskGroup group;
+				_scheduler->Spawn(group, [&] { RecursiveBisectGraph(childGraph[0], start, split); });
+				try {
+					RecursiveBisectGraph(childGraph[1], split, end);
+				}
+				catch (...) {
+					_scheduler->Wait(group);		// the left half still references this frame
+					throw;
+				}
+				_scheduler->Wait(group);
+			}
+			else {
+				RecursiveBisectGraph(childGraph[0], start, split);
+				RecursiveBisectGraph(childGraph[1], split, end);
+			}
 		}
 		else {
-			assert(!childGraph[0] && !childGraph[1]);
+			assert(!childGraph[0].xadj && !childGraph[1].xadj);
+		}
+	}
+
+	// the parts linked to node and the weight of the links to each, in the order they are met.
+	static void GatherPartLinks(const Graph& graph, const idx_t* parts, uint32_t node, PartitionerVector<std::pair<idx_t, int32_t>>& links) {
+		links.clear();
+		const int32_t* adjwgt = graph.GetAdjwgt().data();
+		for (idx_t j = graph.GetXadj()[node]; j < graph.GetXadj()[node + 1]; j++) {
+			idx_t part = parts[graph.GetAdjncy()[j]];
+			auto it = std::find_if(links.begin(), links.end(), [part](const auto& link) { return link.first == part; });
+			if (it == links.end()) links.push_back({ part, adjwgt[j] });
+			else it->second += adjwgt[j];
+		}
+	}
+
+	void Partitioner::RefineParts(const Graph& graph, idx_t* parts, PartitionerVector<uint32_t>& partSizes) {
+		// boundary nodes leave the parts over maxPartSize for a neighbour with room, and parts with nodes to spare
+		// give them to neighbours under minPartSize; each goes to the part it is linked to most.
+		PartitionerVector<std::pair<idx_t, int32_t>> links;
+		for (uint32_t pass = 0; pass < refinePassNum; pass++) {
+			bool isMoved = false;
+			for (uint32_t i = 0; i < graph.GetNodeNum(); i++) {
+				idx_t from = parts[i];
+				bool isOver = partSizes[from] > _maxPartSize;
+				if (!isOver && partSizes[from] <= _minPartSize) continue;
+
+				GatherPartLinks(graph, parts, i, links);
+				idx_t to = -1;
+				int32_t maxWeight = 0;
+				for (auto [part, weight] : links) {
+					if (part == from) continue;
+					bool isOpen = isOver ? partSizes[part] < _maxPartSize : partSizes[part] < _minPartSize;
+					if (isOpen && weight > maxWeight) to = part, maxWeight = weight;
+				}
+				if (to < 0) continue;
+
+				parts[i] = to;
+				partSizes[from]--;
+				partSizes[to]++;
+				isMoved = true;
+			}
+			if (!isMoved) break;
+		}
+	}
+
+	void Partitioner::MergeParts(const Graph& graph, idx_t* parts, PartitionerVector<uint32_t>& partSizes) {
+		const idx_t partNum = partSizes.size();
+		PartitionerVector<uint32_t> partStart;
+		SortByPart(parts, partNum, partStart);
+
+		PartitionerVector<idx_t> mergeTo(partNum);
+		for (idx_t i = 0; i < partNum; i++) mergeTo[i] = i;
+		auto findRoot = [&](idx_t part) {
+			while (mergeTo[part] != part) part = mergeTo[part];
+			return part;
+		};
+
+		// a part still under minPartSize joins the neighbour it is linked to most, if both fit in maxPartSize.
+		PartitionerVector<std::pair<idx_t, int32_t>> links;
+		for (idx_t p = 0; p < partNum; p++) {
+			if (partSizes[p] == 0 || partSizes[p] >= _minPartSize) continue;
+
+			links.clear();
+			for (uint32_t k = partStart[p]; k < partStart[p + 1]; k++) {
+				uint32_t node = _nodeId[k];
+				for (idx_t j = graph.GetXadj()[node]; j < graph.GetXadj()[node + 1]; j++) {
+					idx_t part = findRoot(parts[graph.GetAdjncy()[j]]);
+					if (part == p) continue;
+					auto it = std::find_if(links.begin(), links.end(), [part](const auto& link) { return link.first == part; });
+					if (it == links.end()) links.push_back({ part, graph.GetAdjwgt()[j] });
+					else it->second += graph.GetAdjwgt()[j];
+				}
+			}
+
+			idx_t to = -1;
+			int32_t maxWeight = 0;
+			for (auto [part, weight] : links) {
+				if (partSizes[p] + partSizes[part] <= _maxPartSize && weight > maxWeight) to = part, maxWeight = weight;
+			}
+			if (to < 0) continue;
+
+			mergeTo[p] = to;
+			partSizes[to] += partSizes[p];
+			partSizes[p] = 0;
+		}
+
+		for (uint32_t i = 0; i < graph.GetNodeNum(); i++) {
+			parts[i] = findRoot(parts[i]);
+		}
+	}
+
+	void Partitioner::SortByPart(const idx_t* parts, uint32_t partNum, PartitionerVector<uint32_t>& partStart) {
+		// counting sort, nodes keep their id order inside a part.
+		partStart.assign(partNum + 1, 0);
+		for (uint32_t i = 0; i < _nodeId.size(); i++) partStart[parts[i] + 1]++;
+		for (uint32_t p = 0; p < partNum; p++) partStart[p + 1] += partStart[p];
+		for (uint32_t i = 0; i < _nodeId.size(); i++) _nodeId[partStart[parts[i]]++] = i;
+		for (uint32_t p = partNum; p > 0; p--) partStart[p] = partStart[p - 1];
+		partStart[0] = 0;
+
+		for (uint32_t i = 0; i < _nodeId.size(); i++) {
+			_sortTo[_nodeId[i]] = i;
+		}
+	}
+
+	void Partitioner::PartitionKWay(const Graph& graph) {
+		const uint32_t nodeNum = graph.GetNodeNum();
+		const uint32_t expectPartSize = (_minPartSize + _maxPartSize) / 2;
+		idx_t partNum = (nodeNum + expectPartSize - 1) / expectPartSize;		// ceiling
+		idx_t* parts = _parts.data();
+
+		idx_t nvtxs = nodeNum, nw = 1, ncut = 0;
+		idx_t options[METIS_NOPTIONS];
+		METIS_SetDefaultOptions(options);
+		// let the parts grow to maxPartSize (the imbalance is in 1/1000 of the average), the repair does the rest.
+		options[METIS_OPTION_UFACTOR] = std::max<idx_t>(1, 1000 * (_maxPartSize - expectPartSize) / expectPartSize);
+
+		int result = METIS_PartGraphKway(
+			&nvtxs,
+			&nw,
+			const_cast<idx_t*>(graph.GetXadj().data()),
+			const_cast<idx_t*>(graph.GetAdjncy().data()),
+			nullptr,
+			nullptr,
+			const_cast<idx_t*>(graph.GetAdjwgt().data()),
+			&partNum,
+			nullptr,
+			nullptr,
+			options,
+			&ncut,
+			parts
+		);
+		assert(result == METIS_OK);
+
+		PartitionerVector<uint32_t> partSizes(partNum, 0);
+		for (uint32_t i = 0; i < nodeNum; i++) partSizes[parts[i]]++;
+		RefineParts(graph, parts, partSizes);
+		MergeParts(graph, parts, partSizes);
+
+		PartitionerVector<uint32_t> partStart;
+		SortByPart(parts, partNum, partStart);
+
+		// parts still over maxPartSize are bisected like a whole graph would be, each from its own slice of buffer 0.
+		PartitionerVector<std::tuple<MetisGraph, uint32_t, uint32_t>> overflows;
+		uint32_t edgeOffset = 0;
+		for (idx_t p = 0; p < partNum; p++) {
+			const uint32_t start = partStart[p], end = partStart[p + 1];
+			if (start == end) continue;
+			if (end - start <= _maxPartSize) {
+				_isRangeStart[start] = 1;
+				continue;
+			}
+
+			MetisGraph subGraph;
+			subGraph.nvtxs = end - start;
+			subGraph.buffer = 0;
+			subGraph.edgeOffset = edgeOffset;
+			subGraph.xadj = _xadj[0].data() + 2 * start;
+			subGraph.adjncy = _adjncy[0].data() + edgeOffset;
+			subGraph.adjwgt = _adjwgt[0].data() + edgeOffset;
+
+			uint32_t edgeNum = 0;
+			for (idx_t i = 0; i < subGraph.nvtxs; i++) {
+				uint32_t node = _nodeId[start + i];
+				subGraph.xadj[i] = edgeNum;
+				for (idx_t j = graph.GetXadj()[node]; j < graph.GetXadj()[node + 1]; j++) {
+					uint32_t to = _sortTo[graph.GetAdjncy()[j]];
+					if (start <= to && to < end) {
+						subGraph.adjncy[edgeNum] = to - start;
+						subGraph.adjwgt[edgeNum] = graph.GetAdjwgt()[j];
+						edgeNum++;
+					}
+				}
+			}
+			subGraph.xadj[subGraph.nvtxs] = edgeNum;
+			edgeOffset += edgeNum;
+			overflows.push_back({ subGraph, start, end });
+		}
+
+		auto bisect = [&](uint32_t i) {
+			auto& [subGraph, start, end] = overflows[i];
+			RecursiveBisectGraph(subGraph, start, end);
+		};
+		if (_scheduler) _scheduler->ParallelFor(overflows.size(), bisect);
+		else for (uint32_t i = 0; i < overflows.size(); i++) bisect(i);
+	}
+
+	void Partitioner::PartitionSpatial(const Graph& graph) {
+		const uint32_t nodeNum = graph.GetNodeNum();
+		assert(_positions.size() == nodeNum);
+
+		PartitionerVector<uint64_t> mortonKeys;
+		SortByMortonCode(_positions, mortonKeys);
+
+		PartitionerVector<float> mortonRank(nodeNum);
+		for (uint32_t i = 0; i < nodeNum; i++) {
+			mortonRank[uint32_t(mortonKeys[i])] = 0.5f * i / nodeNum;
+		}
+
+		// each part starts at the first free node along the curve and takes the frontier node linked to it
+		// most (the earlier on the curve on ties) until it is full.
+		idx_t* parts = _parts.data();
+		std::fill(parts, parts + nodeNum, -1);
+		PartitionerVector<uint32_t> partSizes;
+		Util::Heap frontier(nodeNum, Util::MemoryTag::Partitioner);
+		const int32_t* adjwgt = graph.GetAdjwgt().data();
+
+		uint32_t next = 0;		// nodes before it on the curve are all taken
+		for (uint32_t cursor = 0; cursor < nodeNum; cursor++) {
+			uint32_t seed = uint32_t(mortonKeys[cursor]);
+			if (parts[seed] >= 0) continue;
+
+			idx_t part = partSizes.size();
+			uint32_t size = 0;
+			frontier.Add(mortonRank[seed], seed);
+			next = std::max(next, cursor + 1);
+			while (size < _maxPartSize) {
+				if (frontier.Empty()) {
+					// walled in before it is full, carry on from the next free node along the curve, it is close by.
+					while (next < nodeNum && parts[uint32_t(mortonKeys[next])] >= 0) next++;
+					if (next == nodeNum || size >= _minPartSize) break;
+					frontier.Add(mortonRank[uint32_t(mortonKeys[next])], uint32_t(mortonKeys[next]));
+				}
+				uint32_t node = frontier.Top();
+				frontier.Pop();
+				parts[node] = part;
+				size++;
+
+				for (idx_t j = graph.GetXadj()[node]; j < graph.GetXadj()[node + 1]; j++) {
+					uint32_t to = graph.GetAdjncy()[j];
+					if (parts[to] >= 0) continue;
+					if (frontier.IsPresent(to)) frontier.Update(frontier.GetKey(to) - adjwgt[j], to);
+					else frontier.Add(mortonRank[to] - adjwgt[j], to);
+				}
+			}
+			while (!frontier.Empty()) frontier.Pop();
+			partSizes.push_back(size);
+		}
+
+		// the last parts along the curve can still be small, the same repair as for k-way parts handles them.
+		RefineParts(graph, parts, partSizes);
+		MergeParts(graph, parts, partSizes);
+
+		PartitionerVector<uint32_t> partStart;
+		SortByPart(parts, partSizes.size(), partStart);
+		for (uint32_t p = 0; p < partSizes.size(); p++) {
+			assert(partSizes[p] <= _maxPartSize);
+			if (partSizes[p] != 0) _isRangeStart[partStart[p]] = 1;
 		}
 	}
 
@@ -150,17 +486,68 @@ namespace Core {
 		}
 	}
 
-	void Partitioner::Partition(const Graph& graph, uint32_t minPartSize, uint32_t maxPartSize) {
-		Init(graph.GetGraph().size());
+	void Partitioner::Partition(const Graph& graph, uint32_t minPartSize, uint32_t maxPartSize, Util::Scheduler* scheduler) {
+		Init(graph.GetNodeNum());
 		_minPartSize = minPartSize;
 		_maxPartSize = maxPartSize;
+		_scheduler = scheduler;
+		_ranges.clear();
+		_isRangeStart.assign(graph.GetNodeNum(), 0);
 
-		MetisGraph* graphData = ToMetisData(graph);
-		RecursiveBisectGraph(graphData, 0, graphData->nvtxs);
+		uint32_t nodeNum = graph.GetNodeNum();
+		if (nodeNum == 0) return;		// no ranges, the bisection would mark one at node 0
+		if (nodeNum > _maxPartSize) {
+			for (uint32_t i = 0; i < 2; i++) {
+				_xadj[i].resize(2 * nodeNum + 1);
+				_adjncy[i].resize(graph.GetEdgeNum());
+				_adjwgt[i].resize(graph.GetEdgeNum());
+			}
+			_parts.resize(nodeNum);
+			_swapTo.resize(nodeNum);
+		}
 
-		std::sort(_ranges.begin(), _ranges.end());
+		if (_strategy == PartitionStrategy::KWay && nodeNum > _maxPartSize) {
+			PartitionKWay(graph);
+		}
+		else if (_strategy == PartitionStrategy::Spatial && nodeNum > _maxPartSize) {
+			PartitionSpatial(graph);
+		}
+		else {
+			// METIS takes the arrays as non-const but does not write them, the input graph is the first subgraph.
+			MetisGraph graphData;
+			graphData.nvtxs = nodeNum;
+			graphData.xadj = const_cast<idx_t*>(graph.GetXadj().data());
+			graphData.adjncy = const_cast<idx_t*>(graph.GetAdjncy().data());
+			graphData.adjwgt = const_cast<idx_t*>(graph.GetAdjwgt().data());
+			graphData.edgeOffset = 0;
+			graphData.buffer = 1;
+			RecursiveBisectGraph(graphData, 0, nodeNum);
+		}
+
+		// the leaves tile [0, nodeNum), so the ranges come out sorted whatever order they finished in.
+		for (uint32_t i = 0; i < nodeNum; i++) {
+			if (!_isRangeStart[i]) continue;
+			if (!_ranges.empty()) _ranges.back().second = i;
+			_ranges.push_back({ i, nodeNum });
+		}
 		for (auto i = 0; i < _nodeId.size(); i++) {
 			_sortTo[_nodeId[i]] = i;
 		}
 	}
+
+	uint64_t Partitioner::GetEdgeCut(const Graph& graph) const {
+		PartitionerVector<uint32_t> rangeId(graph.GetNodeNum());
+		for (uint32_t r = 0; r < _ranges.size(); r++) {
+			for (uint32_t i = _ranges[r].first; i < _ranges[r].second; i++) rangeId[_nodeId[i]] = r;
+		}
+
+		// every edge is stored at both of its nodes.
+		uint64_t cut = 0;
+		for (uint32_t i = 0; i < graph.GetNodeNum(); i++) {
+			for (idx_t j = graph.GetXadj()[i]; j < graph.GetXadj()[i + 1]; j++) {
+				if (rangeId[i] != rangeId[graph.GetAdjncy()[j]]) cut += graph.GetAdjwgt()[j];
+			}
+		}
+		return cut / 2;
+	}
 }
\ No newline at end of file
@@ -1,41 +1,100 @@
 #pragma once
 
+#include "MemoryTracker.h"
+#include "Scheduler.h"
+
+#include <glm/glm.hpp>
+#include <span>
 #include <vector>
-#include <map>
 
 namespace Core {
+	template <typename T>
+	using PartitionerVector = Util::TrackedVector<T, Util::MemoryTag::Partitioner>;
+
+	// adjacency in compressed sparse rows, the layout METIS takes: the edges of node i are [xadj[i], xadj[i + 1]).
+	// nodes are built in order, each by AddEdge calls closed with FinishNode.
 	class Graph final{
 	public:
-		void Init(uint32_t n) { _graph.resize(n); }
-		void AddNode() { _graph.push_back({}); }
-		void AddEdge(uint32_t from, uint32_t to, int32_t cost) { _graph[from][to] = cost; }
-		void IncreaseEdgeCost(uint32_t from, uint32_t to, int32_t cost) { _graph[from][to] += cost; }
+		void Init(uint32_t nodeNum, uint32_t edgeNum = 0);
+		void AddEdge(uint32_t to, int32_t cost) { _adjncy.push_back(to); _adjwgt.push_back(cost); }
+		void FinishNode();		// sort the edges of the node by target and add up repeated ones
+		// all rows at once, e.g. from tasks : rowSizes[node] edges per node, each slot then written by SetEdge with
+		// the edges of a row sorted by target and not repeated, as FinishNode leaves them.
+		void InitRows(std::span<const uint32_t> rowSizes);
+		void SetEdge(uint32_t node, uint32_t slot, uint32_t to, int32_t cost) { _adjncy[_xadj[node] + slot] = to; _adjwgt[_xadj[node] + slot] = cost; }
+
+		uint32_t GetNodeNum() const { return _xadj.size() - 1; }
+		uint32_t GetEdgeNum() const { return _adjncy.size(); }
+		std::span<const int32_t> GetEdges(uint32_t node) const { return { _adjncy.data() + _xadj[node], _adjncy.data() + _xadj[node + 1] }; }
 
-		const std::vector<std::map<uint32_t, int32_t>>& GetGraph() const { return _graph; }
+		const PartitionerVector<int32_t>& GetXadj() const { return _xadj; }
+		const PartitionerVector<int32_t>& GetAdjncy() const { return _adjncy; }
+		const PartitionerVector<int32_t>& GetAdjwgt() const { return _adjwgt; }
 
 	private:
-		std::vector<std::map<uint32_t, int32_t>> _graph;
+		PartitionerVector<int32_t> _xadj = { 0 };
+		PartitionerVector<int32_t> _adjncy;
+		PartitionerVector<int32_t> _adjwgt;
 	};
 
 	struct MetisGraph;
 
+	enum class PartitionStrategy : uint32_t {
+		Bisection,		// METIS bisection, recursively down to maxPartSize
+		KWay,			// one k-way METIS call for all the parts, then the part sizes are repaired
+		Spatial,		// parts grown greedily along the Morton order of the node positions, no METIS, for previews
+	};
+
+	const char* ToString(PartitionStrategy strategy);
+
+	// (Morton code << 32 | index) of every position, sorted; the codes are taken on the bounding box of all of them.
+	void SortByMortonCode(std::span<const glm::vec3> positions, PartitionerVector<uint64_t>& mortonKeys);
+
 	class Partitioner final{
 	public:
+		Partitioner(PartitionStrategy strategy = PartitionStrategy::Bisection) : _strategy(strategy) {}
+
+		PartitionStrategy GetStrategy() const { return _strategy; }
+		void SetStrategy(PartitionStrategy strategy) { _strategy = strategy; }		// a reused partitioner keeps its buffers
+
 		void Init(uint32_t nodeNum);
-		void Partition(const Graph& graph, uint32_t minPartSize, uint32_t maxPartSize);
+		// one per node, only the spatial strategy reads them; they must outlive the Partition call.
+		void SetNodePositions(std::span<const glm::vec3> positions) { _positions = positions; }
+		// with a scheduler the two halves of big subgraphs are bisected in parallel, the result is the same.
+		void Partition(const Graph& graph, uint32_t minPartSize, uint32_t maxPartSize, Util::Scheduler* scheduler = nullptr);
+		uint64_t GetEdgeCut(const Graph& graph) const;		// weight of the edges between ranges of the last Partition
 
-		const std::vector<std::pair<uint32_t, uint32_t>>& GetRanges() const { return _ranges; }
+		const PartitionerVector<std::pair<uint32_t, uint32_t>>& GetRanges() const { return _ranges; }
 		const uint32_t& GetNodeId(uint32_t id) const { return _nodeId[id]; }
 		const uint32_t& GetSortTo(uint32_t id) const { return _sortTo[id]; }
 
 	private:
-		std::vector<uint32_t> _nodeId;						// ordered by id
-		std::vector<std::pair<uint32_t, uint32_t>> _ranges;	// the range of block
-		std::vector<uint32_t> _sortTo;
+		PartitionStrategy _strategy;
+		std::span<const glm::vec3> _positions;
+		PartitionerVector<uint32_t> _nodeId;						// ordered by id
+		PartitionerVector<std::pair<uint32_t, uint32_t>> _ranges;	// the range of block
+		PartitionerVector<uint32_t> _sortTo;
 		uint32_t _minPartSize;
 		uint32_t _maxPartSize;
+		Util::Scheduler* _scheduler;
+		PartitionerVector<uint8_t> _isRangeStart;		// leaves mark their first node, each at its own index
+
+		// double buffered subgraphs, a child is written to the buffer its parent was not read from. Node range
+		// [start, end) keeps its xadj at [2 * start, 2 * start + n] and its edges inside the edges of its parent,
+		// so the subgraphs of disjoint ranges never overlap and the buffers are allocated once per Partition.
+		PartitionerVector<int32_t> _xadj[2];
+		PartitionerVector<int32_t> _adjncy[2];
+		PartitionerVector<int32_t> _adjwgt[2];
+		PartitionerVector<int32_t> _parts;		// [start, end) used by the range being bisected
+		PartitionerVector<int32_t> _swapTo;
+
+		uint32_t BisectGraph(const MetisGraph& graphData, MetisGraph* childGraphs, uint32_t start, uint32_t end);
+		void RecursiveBisectGraph(const MetisGraph& graphData, uint32_t start, uint32_t end);
 
-		uint32_t BisectGraph(MetisGraph* graphData, MetisGraph* childGraphs[2], uint32_t start, uint32_t end);
-		void RecursiveBisectGraph(MetisGraph* graphData, uint32_t start, uint32_t end);
+		void PartitionKWay(const Graph& graph);
+		void PartitionSpatial(const Graph& graph);
+		void RefineParts(const Graph& graph, int32_t* parts, PartitionerVector<uint32_t>& partSizes);
+		void MergeParts(const Graph& graph, int32_t* parts, PartitionerVector<uint32_t>& partSizes);
+		void SortByPart(const int32_t* parts, uint32_t partNum, PartitionerVector<uint32_t>& partStart);
 	};
 }
\ No newline at end of file
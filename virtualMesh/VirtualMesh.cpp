@@ -1,61 +1,803 @@
 #include "VirtualMesh.h"
+#include "ClusterIO.h"
 #include "timer.h"
 
+#include <algorithm>
+#include <cfloat>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+
 namespace Core {
 
-void VirtualMesh::Build(Mesh& mesh)
+uint64_t VirtualMesh::EstimateBuildMemory(uint64_t triangleNum, uint64_t bytesPerTriangle)
+{
+    return triangleNum * bytesPerTriangle;
+}
+
+// the limit is process wide, put the previous one back however the build ends.
+class MemoryLimitScope final {
+public:
+    MemoryLimitScope(uint64_t limit)
+        : _previous(Util::MemoryTracker::GetLimit())
+    {
+        if (limit != 0)
+            Util::MemoryTracker::SetLimit(limit);
+    }
+    ~MemoryLimitScope() { Util::MemoryTracker::SetLimit(_previous); }
+
+private:
+    uint64_t _previous;
+};
+
+void VirtualMesh::Build(Mesh& mesh, const BuildConfig& config)
 {
     Util::Timer timer;
+    Util::Scheduler scheduler(config.threadNum);
+    GroupCache groupCache(config.groupCacheDirectory);
+    BuildContext context { scheduler, groupCache, config.partition, config.simplifier, config.weld };
 
     auto& vertices = mesh.vertices;
     auto& indices = mesh.indices;
 
-    MeshSimplifier meshSimplifier(vertices.data(), vertices.size(), indices.data(), indices.size());
-    meshSimplifier.Simplify(indices.size());
-    vertices.resize(meshSimplifier.RemainingVertNum());
-    indices.resize(meshSimplifier.RemainingTriangleNum() * 3);
-    timer.log("Success simplify mesh");
-    std::cerr << "After remove duplicate vertex - verts : " << vertices.size() << " tris: " << indices.size() / 3 << "\n\n";
+    // the input mesh is owned by the caller, count it for the whole build.
+    MemoryLimitScope memoryLimit(config.memoryLimit);
+    Util::ScopedMemory meshMemory(Util::MemoryTag::Mesh, vertices.capacity() * sizeof(glm::vec3) + indices.capacity() * sizeof(uint32_t));
+    Util::MemoryTracker::ResetPeak();
+    _stageTimer.reset();
+    _stageMemory.clear();
+    _partitionQuality.clear();
+
+    uint64_t estimatedMemory = EstimateBuildMemory(indices.size() / 3, config.buildBytesPerTriangle);
+    bool isStreaming = config.memoryBudget != 0 && estimatedMemory > config.memoryBudget;
+    if (isStreaming && !config.checkpointDirectory.empty()) {
+        throw std::invalid_argument("checkpoints are not supported by streaming builds, clear the checkpoint directory or the memory budget");
+    }
+    if (config.memoryLimit != 0 && !isStreaming && estimatedMemory > config.memoryLimit) {
+        std::cerr << "Warning: the in-core build is estimated at " << estimatedMemory
+                  << " bytes, above the memory limit of " << config.memoryLimit << " bytes; set a memory budget to stream it\n";
+    }
+
+    if (isStreaming) {
+        BuildStreaming(mesh, config, context);
+        WriteReport(config.reportFileName, &scheduler);
+        return;
+    }
+
+    LevelCheckpoint checkpoint(config.checkpointDirectory);
+    uint64_t meshHash = 0;
+    LevelState state;
+    bool isResumed = false;
+    if (checkpoint.IsEnabled()) {
+        meshHash = LevelCheckpoint::HashMesh(vertices, indices, config.partition, config.simplifier, config.weld);
+        isResumed = checkpoint.Load(meshHash, _clusters, _clusterGroups, state);
+    }
 
-    timer.reset();
-    std::cerr << "--- Begin Build Clusters ---\n\n";
-    Cluster::BuildClusters(vertices, indices, _clusters);
-    timer.log("Success build clusters");
-    std::cerr << "Cluster size: " << _clusters.size() << "\n\n";
+    if (isResumed) {
+        timer.log("Success load checkpoint");
+        std::cerr << "Resume from level " << state.mipLevel << " with " << _clusters.size() << " clusters\n\n";
+    } else {
+        RemoveDuplicates(vertices, indices, config.weld, &scheduler);
+        timer.log("Success weld mesh");
+        RecordStageMemory("weld");
+        std::cerr << "After weld - verts : " << vertices.size() << " tris: " << indices.size() / 3 << "\n\n";
+        if (indices.empty()) {
+            _clusters.clear();
+            _clusterGroups.clear();
+            _mipLevelNums = 0;
+            throw std::runtime_error("the mesh has no triangles left after welding");
+        }
+
+        timer.reset();
+        std::cerr << "--- Begin Build Clusters ---\n\n";
+        Cluster::BuildClusters(vertices, indices, _clusters, &scheduler, config.partition);
+        timer.log("Success build clusters");
+        RecordStageMemory("build clusters");
+        std::cerr << "Cluster size: " << _clusters.size() << "\n\n";
+
+        if (!config.reportFileName.empty()) {
+            ComparePartitions(vertices, indices, context);
+            RecordStageMemory("compare partitions");
+        }
+    }
 
     std::cerr << "--- Begin Build DAG ---\n\n";
-    uint32_t levelOffset = 0, mipLevel = 0, maxMipLevel = 8, preClusterNum = 0;
-    int n = 6;
-    while (n) {
-        std::cout << "- Level: " << mipLevel << "\nClusters num is: " << _clusters.size() - levelOffset << "\n";
-
-        auto clusterNums = _clusters.size() - levelOffset;
-        if (clusterNums <= 2) {
-           // _clusters[_clusters.size() - 1].groupId = _clusterGroups.size();
-            break;
+    std::function<void(const LevelState&)> onLevelDone = [&](const LevelState& state) {
+        RecordStageMemory("level " + std::to_string(state.mipLevel - 1));
+        if (checkpoint.IsEnabled()) {
+            checkpoint.Save(meshHash, _clusters, _clusterGroups, state);
+        }
+    };
+    BuildLevels(_clusters, _clusterGroups, state, context, true, onLevelDone);
+    _mipLevelNums = state.mipLevel + 1;
+
+    std::cout << "\nThe total num of clusters is: " << _clusters.size() << "\n\n";
+    std::cout << "--- End Process Mesh ---\n\n";
+    WriteReport(config.reportFileName, &scheduler);
+}
+
+void VirtualMesh::RecordStageMemory(const std::string& stage)
+{
+    auto peak = Util::MemoryTracker::GetPeak();
+    double milliseconds = _stageTimer.timeDuration() * 0.001;
+    _stageMemory.push_back({ stage, peak, milliseconds });
+    Util::MemoryTracker::ResetPeak();
+    _stageTimer.reset();
+
+    std::cerr << "Peak memory of " << stage << ": " << peak.total / 1024 << " KB (";
+    for (uint32_t tag = 0; tag < (uint32_t)Util::MemoryTag::Count; tag++) {
+        std::cerr << (tag ? ", " : "") << Util::ToString(Util::MemoryTag(tag)) << " " << peak.tags[tag] / 1024;
+    }
+    std::cerr << ")\n";
+}
+
+void VirtualMesh::Pack(std::vector<uint32_t>& packedData, Util::Scheduler* scheduler) const
+{
+    const auto& clusters = _clusters;
+    const auto& groups = _clusterGroups;
+
+    // where the payload of every cluster and then of every group starts, so each record and payload is written
+    // into its own words and clusters pack in parallel. The data does not depend on the thread count.
+    const uint32_t groupOffset = PackedLayout::headerWords + PackedLayout::clusterWords * clusters.size();
+    std::vector<uint32_t> dataOffsets(clusters.size() + groups.size());
+    uint64_t packedWords = groupOffset + uint64_t(PackedLayout::groupWords) * groups.size();
+    for (uint32_t i = 0; i < clusters.size(); i++) {
+        dataOffsets[i] = packedWords;
+        packedWords += clusters[i].verts.size() * 3 + clusters[i].indices.size() / 3;
+    }
+    for (uint32_t i = 0; i < groups.size(); i++) {
+        dataOffsets[clusters.size() + i] = packedWords;
+        packedWords += groups[i].clusters.size();
+    }
+
+    // size the output once, so a memory limit trips before packing starts and the data never regrows.
+    Util::ScopedMemory packedMemory(Util::MemoryTag::Encode, packedWords * sizeof(uint32_t));
+    packedData.assign(packedWords, 0);
+    packedData[0] = clusters.size();    // clusters num
+    packedData[1] = groups.size();      // groups num
+    packedData[2] = groupOffset;        // group data offset
+    packedData[3] = PackedLayout::format;
+
+    Util::ForEachChunk(scheduler, clusters.size(), [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            const auto& cluster = clusters[i];
+            uint32_t* record = &packedData[PackedLayout::headerWords + PackedLayout::clusterWords * i];
+            auto push = [&](uint32_t word) { *record++ = word; };
+
+            push(cluster.verts.size());         // vertex nums
+            push(dataOffsets[i]);               // vertex data offset
+            push(cluster.indices.size() / 3);   // triangle nums
+            push(dataOffsets[i] + cluster.verts.size() * 3); // vertex id data offset
+
+            push(Util::Float2Uint(cluster.sphereBounds.center.x));
+            push(Util::Float2Uint(cluster.sphereBounds.center.y));
+            push(Util::Float2Uint(cluster.sphereBounds.center.z));
+            push(Util::Float2Uint(cluster.sphereBounds.radius));
+
+            push(Util::Float2Uint(cluster.lodBounds.center.x));
+            push(Util::Float2Uint(cluster.lodBounds.center.y));
+            push(Util::Float2Uint(cluster.lodBounds.center.z));
+            push(Util::Float2Uint(cluster.lodBounds.radius));
+
+            // clusters without a group (DAGs built before the root group) are their own parent.
+            bool hasGroup = cluster.groupId < groups.size();
+            Sphere parentLodBounds = hasGroup ? groups[cluster.groupId].lodBounds : cluster.lodBounds;
+            float maxParentLodError = hasGroup ? groups[cluster.groupId].maxParentLodError : cluster.lodError;
+
+            push(Util::Float2Uint(parentLodBounds.center.x));
+            push(Util::Float2Uint(parentLodBounds.center.y));
+            push(Util::Float2Uint(parentLodBounds.center.z));
+            push(Util::Float2Uint(parentLodBounds.radius));
+
+            push(Util::Float2Uint(cluster.lodError));
+            push(Util::Float2Uint(maxParentLodError));
+            push(cluster.groupId);
+            push(cluster.mipLevel);
+
+            push(Util::Float2Uint(cluster.normalCone.apex.x));
+            push(Util::Float2Uint(cluster.normalCone.apex.y));
+            push(Util::Float2Uint(cluster.normalCone.apex.z));
+            push(Util::Float2Uint(cluster.normalCone.cutoff));
+
+            push(Util::Float2Uint(cluster.normalCone.axis.x));
+            push(Util::Float2Uint(cluster.normalCone.axis.y));
+            push(Util::Float2Uint(cluster.normalCone.axis.z));
+            push(0);
+
+            push(Util::Float2Uint(cluster.boxBounds.pMin.x));
+            push(Util::Float2Uint(cluster.boxBounds.pMin.y));
+            push(Util::Float2Uint(cluster.boxBounds.pMin.z));
+            push(0);
+
+            push(Util::Float2Uint(cluster.boxBounds.pMax.x));
+            push(Util::Float2Uint(cluster.boxBounds.pMax.y));
+            push(Util::Float2Uint(cluster.boxBounds.pMax.z));
+            push(0);
+
+            uint32_t* data = &packedData[dataOffsets[i]];
+            for (auto& v : cluster.verts) {
+                *data++ = Util::Float2Uint(v.x);
+                *data++ = Util::Float2Uint(v.y);
+                *data++ = Util::Float2Uint(v.z);
+            }
+            for (uint32_t k = 0; k < cluster.indices.size() / 3; k++) {
+                auto i0 = cluster.indices[k * 3 + 0];
+                auto i1 = cluster.indices[k * 3 + 1];
+                auto i2 = cluster.indices[k * 3 + 2];
+                assert(i0 < 256 && i1 < 256 && i2 < 256);
+
+                *data++ = i0 | (i1 << 8) | (i2 << 16);
+            }
+        }
+    }, 256);
+
+    for (uint32_t i = 0; i < groups.size(); i++) {
+        const auto& group = groups[i];
+        uint32_t* record = &packedData[groupOffset + PackedLayout::groupWords * i];
+        auto push = [&](uint32_t word) { *record++ = word; };
+
+        push(group.clusters.size());    // group cluster num
+        push(dataOffsets[clusters.size() + i]); // group cluster offset
+        push(Util::Float2Uint(group.maxParentLodError));
+        push(0);
+
+        push(Util::Float2Uint(group.lodBounds.center.x));
+        push(Util::Float2Uint(group.lodBounds.center.y));
+        push(Util::Float2Uint(group.lodBounds.center.z));
+        push(Util::Float2Uint(group.lodBounds.radius));
+
+        std::copy(group.clusters.begin(), group.clusters.end(), packedData.begin() + dataOffsets[clusters.size() + i]);
+    }
+}
+
+void VirtualMesh::WriteReport(const std::string& fileName, Util::Scheduler* scheduler) const
+{
+    if (fileName.empty())
+        return;
+
+    BuildReport report;
+    BuildReport::Collect(*this, report);
+    {
+        std::vector<uint32_t> packedData;
+        Pack(packedData, scheduler);
+        report.fingerprint = BuildReport::Fingerprint(packedData);
+    }
+    std::cerr << "Fingerprint of the packed data: " << BuildReport::FormatFingerprint(report.fingerprint) << "\n";
+    if (!report.WriteJson(fileName)) {
+        std::cerr << "Error writing build report to " << fileName << "\n";
+    }
+}
+
+void VirtualMesh::ComparePartitions(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, const BuildContext& context)
+{
+    // partition the base level again with the build config and, if that is not it already, with plain METIS bisection.
+    const auto& buildConfig = context.partition;
+    std::vector<PartitionConfig> configs = { buildConfig };
+    if (buildConfig.strategy != PartitionStrategy::Bisection || buildConfig.isLengthWeighted || buildConfig.proximityLinkNum)
+        configs.push_back(PartitionConfig());
+
+    // cuts are counted on the unweighted graph, so they compare across weightings.
+    Graph edgeLink, plainGraph;
+    Cluster::BuildTriangleGraph(vertices, indices, PartitionConfig(), edgeLink, plainGraph, &context.scheduler);
+
+    for (const auto& config : configs) {
+        Graph graph;
+        Cluster::BuildTriangleGraph(vertices, indices, config, edgeLink, graph, &context.scheduler);
+
+        Util::Timer timer;
+        Partitioner partitioner(config.strategy);
+        Cluster::PartitionTriangles(vertices, indices, graph, partitioner, &context.scheduler);
+
+        PartitionQuality quality;
+        quality.strategy = ToString(config.strategy);
+        quality.isLengthWeighted = config.isLengthWeighted;
+        quality.proximityLinkNum = config.proximityLinkNum;
+        quality.milliseconds = timer.timeDuration() * 0.001;
+        quality.partNum = partitioner.GetRanges().size();
+        quality.edgeCut = partitioner.GetEdgeCut(plainGraph);
+
+        std::vector<glm::vec3> positions;
+        for (auto [left, right] : partitioner.GetRanges()) {
+            quality.underfilledPartNum += right - left < Cluster::clusterSize - 4;
+            positions.clear();
+            for (uint32_t i = left; i < right; i++) {
+                uint32_t triangleId = partitioner.GetNodeId(i);
+                for (uint32_t k = 0; k < 3; k++) positions.push_back(vertices[indices[triangleId * 3 + k]]);
+            }
+            quality.avgClusterRadius += Sphere::FromPoints(positions.data(), positions.size()).radius;
         }
+        quality.avgClusterRadius /= std::max<uint32_t>(1, quality.partNum);
+
+        // groups of the clusters this build made, so only the grouping differs.
+        std::vector<ClusterGroup> clusterGroups;
+        ClusterGroup::BuildClusterGroups(_clusters, 0, _clusters.size(), 0, clusterGroups, config);
+        quality.groupNum = clusterGroups.size();
+        for (const auto& clusterGroup : clusterGroups)
+            quality.avgGroupRadius += clusterGroup.bounds.radius;
+        quality.avgGroupRadius /= std::max<uint32_t>(1, quality.groupNum);
+        _partitionQuality.push_back(quality);
+
+        std::cerr << "Partition with " << quality.strategy << (quality.isLengthWeighted ? ", length weighted" : "")
+                  << (quality.proximityLinkNum ? ", " + std::to_string(quality.proximityLinkNum) + " proximity links" : "") << ": "
+                  << quality.partNum << " parts, " << quality.underfilledPartNum << " underfilled, edge cut " << quality.edgeCut << ", "
+                  << quality.milliseconds << " ms, avg cluster radius " << quality.avgClusterRadius << ", "
+                  << quality.groupNum << " groups of avg radius " << quality.avgGroupRadius << "\n";
+    }
+    std::cerr << "\n";
+}
+
+void VirtualMesh::RemoveDuplicates(std::vector<glm::vec3>& vertices, std::vector<uint32_t>& indices, const WeldConfig& config, Util::Scheduler* scheduler)
+{
+    WeldStats stats = WeldMesh(vertices, indices, config, scheduler);
+    std::cerr << "Weld : " << stats.weldedVertNum << " verts merged, " << stats.unusedVertNum << " unused, "
+              << stats.degenerateTriangleNum << " degenerate and " << stats.duplicateTriangleNum << " duplicate tris removed\n";
+}
 
-        if (preClusterNum == clusterNums) break;
-        preClusterNum = _clusters.size() - levelOffset;
+void VirtualMesh::BuildLevels(std::vector<Cluster>& clusters, std::vector<ClusterGroup>& clusterGroups, LevelState& state, const BuildContext& context,
+    bool isRooted, const std::function<void(const LevelState&)>& onLevelDone)
+{
+    Util::Timer timer;
+    while (true) {
+        uint32_t clusterNum = clusters.size() - state.levelOffset;
+        std::cout << "- Level: " << state.mipLevel << "\nClusters num is: " << clusterNum << "\n";
+        if (clusterNum <= 1)
+            break;
 
-        auto preClusterNums = _clusters.size();
-        auto preGroupNums = _clusterGroups.size();
+        uint32_t preClusterNum = clusters.size();
+        uint32_t preGroupNum = clusterGroups.size();
 
         timer.reset();
-        ClusterGroup::BuildClusterGroups(_clusters, levelOffset, clusterNums, mipLevel, _clusterGroups);
-        std::cout << "Group num is: " << _clusterGroups.size() - preGroupNums << "\n";
-        for (auto i = preGroupNums; i < _clusterGroups.size(); i++) {
-            ClusterGroup::BuildParentClusters(i, _clusterGroups[i], _clusters);
+        ClusterGroup::BuildClusterGroups(clusters, state.levelOffset, clusterNum, state.mipLevel, clusterGroups, context.partition, state.maxGroupSize,
+            state.isBorderLocked, &context.scheduler, context.isSeam);
+        uint32_t groupNum = clusterGroups.size() - preGroupNum;
+        std::cout << "Group num is: " << groupNum << "\n";
+        uint32_t stalledGroupNum = BuildParentLevel(clusters, clusterGroups, preGroupNum, context);
+        uint32_t parentNum = clusters.size() - preClusterNum;
+
+        // locked edges keep a level from shrinking when they are most of its groups : many open borders or disconnected
+        // parts, or groups that are mostly boundary. Relax first the open borders, which no other group shares, then the
+        // edges between groups by growing the groups; one group of the whole level locks no shared edge.
+        bool isStalled = parentNum >= clusterNum;
+        bool isSlow = parentNum * 4 > clusterNum * 3;
+        bool canRelax = (isRooted || context.isSeam) && (state.isBorderLocked || groupNum > 1);
+        if (isSlow) {
+            uint64_t lockedEdgeNum = 0;
+            for (uint32_t i = preGroupNum; i < clusterGroups.size(); i++)
+                lockedEdgeNum += clusterGroups[i].externalEdges.size();
+            std::cout << "Level " << state.mipLevel << (isStalled ? " stalled" : " shrank slowly") << ": " << clusterNum << " -> " << parentNum
+                      << " clusters, " << stalledGroupNum << " / " << groupNum << " groups of <= " << state.maxGroupSize << " did not shrink, "
+                      << lockedEdgeNum << " locked edges\n";
+            if (canRelax && state.isBorderLocked) {
+                state.isBorderLocked = false;
+                std::cout << "Open borders unlocked\n";
+            } else if (canRelax) {
+                state.maxGroupSize *= 2;
+                std::cout << "Groups grow to <= " << state.maxGroupSize << "\n";
+            }
+        }
+        if (isStalled) {
+            clusters.erase(clusters.begin() + preClusterNum, clusters.end());
+            clusterGroups.erase(clusterGroups.begin() + preGroupNum, clusterGroups.end());
+            if (!canRelax)
+                break;
+            continue;
         }
-        timer.log("Success build level " + std::to_string(mipLevel) + " DAG.");
-        levelOffset = preClusterNums;
-        mipLevel++;
+
+        timer.log("Success build level " + std::to_string(state.mipLevel) + " DAG.");
+        state.levelOffset = preClusterNum;
+        state.mipLevel++;
+
+        if (onLevelDone) onLevelDone(state);
 
         std::cout << std::endl;
     }
-    _mipLevelNums = mipLevel + 1;
+
+    if (isRooted)
+        BuildRootGroup(clusters, clusterGroups, state);
+}
+
+void VirtualMesh::BuildRootGroup(std::vector<Cluster>& clusters, std::vector<ClusterGroup>& clusterGroups, const LevelState& state)
+{
+    // the top level is one group with no parent : its parent error is never small enough, so the renderer always
+    // descends into it, and its clusters get a real group id instead of the slot of a next level that never comes.
+    if (state.levelOffset >= clusters.size())
+        return;
+
+    ClusterGroup root;
+    root.mipLevel = state.mipLevel;
+    std::vector<Sphere> spheres, lodBounds;
+    for (uint32_t i = state.levelOffset; i < clusters.size(); i++) {
+        root.clusters.push_back(i);
+        clusters[i].groupId = clusterGroups.size();
+        spheres.push_back(clusters[i].sphereBounds);
+        lodBounds.push_back(clusters[i].lodBounds);
+    }
+    root.bounds = Sphere::FromSpheres(spheres, spheres.size());
+    root.lodBounds = Sphere::FromSpheres(lodBounds, lodBounds.size());
+    root.maxParentLodError = FLT_MAX;
+    clusterGroups.push_back(std::move(root));
+    std::cout << "Root group of " << clusterGroups.back().clusters.size() << " clusters at level " << state.mipLevel << "\n";
+}
+
+uint32_t VirtualMesh::BuildParentLevel(std::vector<Cluster>& clusters, std::vector<ClusterGroup>& clusterGroups, uint32_t groupOffset, const BuildContext& context)
+{
+    // groups of one level only read the clusters of that level, so each of them simplifies
+    // into its own slot and the results are appended in group order afterwards.
+    uint32_t groupNum = clusterGroups.size() - groupOffset;
+    std::vector<std::vector<Cluster>> parentClusters(groupNum);
+    std::atomic<uint32_t> cacheHits = 0;
+    // freed with the level, so no buffers outlive the build and count towards the memory of a later one.
+    Util::PerThread<ParentClusterScratch> scratches(&context.scheduler);
+
+    auto buildGroup = [&](uint32_t i, Util::Scheduler* scheduler) {
+        auto& clusterGroup = clusterGroups[groupOffset + i];
+        if (!context.groupCache.IsEnabled()) {
+            ClusterGroup::BuildParentClusters(clusterGroup, clusters, parentClusters[i], context.partition, context.simplifier, scheduler, &scratches.Get());
+            return;
+        }
+
+        uint64_t key = GroupCache::HashGroup(clusterGroup, clusters, context.partition, context.simplifier);
+        if (context.groupCache.Load(key, clusterGroup, parentClusters[i])) {
+            cacheHits++;
+        } else {
+            ClusterGroup::BuildParentClusters(clusterGroup, clusters, parentClusters[i], context.partition, context.simplifier, scheduler, &scratches.Get());
+            context.groupCache.Store(key, clusterGroup, parentClusters[i]);
+        }
+    };
+    // with fewer groups than threads (the top levels) the threads work inside each group instead, the
+    // simplifier gives the same result either way.
+    if (groupNum < context.scheduler.GetThreadNum()) {
+        for (uint32_t i = 0; i < groupNum; i++)
+            buildGroup(i, &context.scheduler);
+    } else {
+        context.scheduler.ParallelFor(groupNum, [&](uint32_t i) { buildGroup(i, nullptr); });
+    }
+    if (context.groupCache.IsEnabled()) {
+        std::cout << "Group cache hits: " << cacheHits << " / " << groupNum << "\n";
+    }
+
+    uint32_t stalledGroupNum = 0;
+    for (uint32_t i = 0; i < groupNum; i++) {
+        uint32_t groupId = groupOffset + i;
+        for (uint32_t clusterId : clusterGroups[groupId].clusters) {
+            clusters[clusterId].groupId = groupId;
+        }
+        stalledGroupNum += parentClusters[i].size() >= clusterGroups[groupId].clusters.size();
+        for (auto& cluster : parentClusters[i]) {
+            cluster.groupId = groupId + 1;
+            clusters.push_back(std::move(cluster));
+        }
+    }
+    return stalledGroupNum;
+}
+
+// ----------------------------------------------------------------------------------
+
+// a directory of its own under the spill root for one streaming build, so concurrent builds never share chunk files.
+// Removed with everything in it when the build ends, also when it throws.
+class SpillDirectory final {
+public:
+    SpillDirectory(const std::filesystem::path& root)
+    {
+        std::filesystem::create_directories(root);
+        std::random_device device;
+        std::mt19937_64 random((uint64_t(device()) << 32) ^ device() ^ uint64_t(std::chrono::steady_clock::now().time_since_epoch().count()));
+        for (uint32_t attempt = 0; attempt < 16 && _path.empty(); attempt++) {
+            char name[32];
+            snprintf(name, sizeof(name), "vmesh_spill_%016llx", (unsigned long long)random());
+            if (std::filesystem::create_directory(root / name))
+                _path = root / name;
+        }
+        if (_path.empty())
+            throw std::runtime_error("cannot create a spill directory in " + root.string());
+    }
+    ~SpillDirectory()
+    {
+        std::error_code error;
+        std::filesystem::remove_all(_path, error);
+    }
+    SpillDirectory(const SpillDirectory&) = delete;
+    SpillDirectory& operator=(const SpillDirectory&) = delete;
+
+    const std::filesystem::path& GetPath() const { return _path; }
+
+private:
+    std::filesystem::path _path;
+};
+
+struct SpillChunk {
+    std::string fileName;
+    uint32_t clusterNum; // spilled clusters, local ids [0, clusterNum), the only ones its groups refer to
+    uint32_t groupNum; // spilled groups
+};
+
+// positions used by triangles of more than one chunk. An open edge between two of them is a seam to a chunk that is
+// not merged yet and stays locked, while the open borders of the mesh are free to collapse inside every chunk.
+class ChunkSeams final {
+public:
+    ChunkSeams(const Mesh& mesh, const std::vector<uint32_t>& triangles, const std::vector<std::pair<uint32_t, uint32_t>>& chunkRanges)
+    {
+        // the chunk of every position first, ~0u once a second chunk uses it.
+        Util::HashTable positionTable(mesh.vertices.size(), Util::MemoryTag::Partitioner);
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> positionChunks;
+        for (uint32_t chunk = 0; chunk < chunkRanges.size(); chunk++) {
+            for (uint32_t i = chunkRanges[chunk].first; i < chunkRanges[chunk].second; i++) {
+                for (uint32_t k = 0; k < 3; k++) {
+                    const glm::vec3& position = mesh.vertices[mesh.indices[triangles[i] * 3 + k]];
+                    uint32_t hash = Util::HashTable::HashValue(position);
+                    uint32_t j = positionTable.First(hash);
+                    while (positionTable.IsValid(j) && positions[j] != position) j = positionTable.Next(j);
+                    if (!positionTable.IsValid(j)) {
+                        positionTable.Add(hash, positions.size());
+                        positions.push_back(position);
+                        positionChunks.push_back(chunk);
+                    } else if (positionChunks[j] != chunk) {
+                        positionChunks[j] = ~0u;
+                    }
+                }
+            }
+        }
+
+        _table.Reset(std::count(positionChunks.begin(), positionChunks.end(), ~0u));
+        for (uint32_t i = 0; i < positions.size(); i++) {
+            if (positionChunks[i] != ~0u) continue;
+            _table.Add(Util::HashTable::HashValue(positions[i]), _positions.size());
+            _positions.push_back(positions[i]);
+        }
+    }
+
+    bool IsSeam(const glm::vec3& v0, const glm::vec3& v1) const { return Contains(v0) && Contains(v1); }
+
+private:
+    Util::HashTable _table { Util::MemoryTag::Cluster };
+    std::vector<glm::vec3> _positions;
+
+    bool Contains(const glm::vec3& position) const
+    {
+        for (uint32_t i = _table.First(Util::HashTable::HashValue(position)); _table.IsValid(i); i = _table.Next(i)) {
+            if (_positions[i] == position) return true;
+        }
+        return false;
+    }
+};
+
+// the top level of a chunk or of a merge, kept in memory until it is merged with its neighbours.
+struct MergeNode {
+    std::vector<Cluster> clusters;
+    uint32_t mipLevel = 0;
+    uint64_t triangleNum = 0;
+};
+
+// spills the levels below the top one with all the groups, which only hold clusters of those levels, and returns the top.
+static MergeNode SpillLevels(std::vector<Cluster>& clusters, const std::vector<ClusterGroup>& clusterGroups, const LevelState& state,
+    const std::string& fileName, std::vector<SpillChunk>& chunks)
+{
+    std::ofstream out(fileName, std::ios::binary);
+    for (uint32_t i = 0; i < state.levelOffset; i++) {
+        ClusterIO::WriteCluster(out, clusters[i]);
+    }
+    for (const auto& clusterGroup : clusterGroups) {
+        ClusterIO::WriteClusterGroup(out, clusterGroup);
+    }
+    if (!out) {
+        throw std::runtime_error("cannot spill chunk to " + fileName);
+    }
+    chunks.push_back({ fileName, state.levelOffset, (uint32_t)clusterGroups.size() });
+
+    MergeNode node;
+    node.mipLevel = state.mipLevel;
+    for (uint32_t i = state.levelOffset; i < clusters.size(); i++) {
+        node.triangleNum += clusters[i].indices.size() / 3;
+        node.clusters.push_back(std::move(clusters[i]));
+    }
+    return node;
+}
+
+static void SplitChunks(const Mesh& mesh, std::vector<uint32_t>& triangles, uint32_t begin, uint32_t end, uint32_t maxTriangleNum, std::vector<std::pair<uint32_t, uint32_t>>& chunks)
+{
+    if (end - begin <= maxTriangleNum) {
+        chunks.push_back({ begin, end });
+        return;
+    }
+
+    // centroid * 3, the scale does not matter for ordering.
+    auto centroid = [&](uint32_t triangleId) {
+        return mesh.vertices[mesh.indices[triangleId * 3 + 0]]
+            + mesh.vertices[mesh.indices[triangleId * 3 + 1]]
+            + mesh.vertices[mesh.indices[triangleId * 3 + 2]];
+    };
+
+    Bounds bounds;
+    for (uint32_t i = begin; i < end; i++) {
+        bounds = bounds + centroid(triangles[i]);
+    }
+    glm::vec3 extent = bounds.pMax - bounds.pMin;
+    uint32_t axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+    uint32_t mid = begin + (end - begin) / 2;
+    std::nth_element(triangles.begin() + begin, triangles.begin() + mid, triangles.begin() + end, [&](uint32_t a, uint32_t b) {
+        return centroid(a)[axis] < centroid(b)[axis];
+    });
+
+    SplitChunks(mesh, triangles, begin, mid, maxTriangleNum, chunks);
+    SplitChunks(mesh, triangles, mid, end, maxTriangleNum, chunks);
+}
+
+void VirtualMesh::BuildStreaming(Mesh& mesh, const BuildConfig& config, const BuildContext& context)
+{
+    Util::Timer timer;
+
+    // split the input into spatial chunks whose in-core build fits the budget. The borders between
+    // chunks have no opposite edge inside a chunk, so they are external edges of their clusters and
+    // stay locked while the chunk builds its own levels.
+    uint32_t triangleNum = mesh.indices.size() / 3;
+    uint32_t chunkTriangleNum = std::max<uint64_t>(Cluster::clusterSize * ClusterGroup::maxClusterGroupSize, config.memoryBudget / config.buildBytesPerTriangle);
+
+    std::vector<uint32_t> triangles(triangleNum);
+    std::iota(triangles.begin(), triangles.end(), 0);
+    std::vector<std::pair<uint32_t, uint32_t>> chunkRanges;
+    SplitChunks(mesh, triangles, 0, triangleNum, chunkTriangleNum, chunkRanges);
+
+    ChunkSeams seams(mesh, triangles, chunkRanges);
+    BuildContext chunkContext = context;
+    chunkContext.isSeam = [&](const glm::vec3& v0, const glm::vec3& v1) { return seams.IsSeam(v0, v1); };
+
+    // a failed spill or reload throws, a DAG with missing chunks must never look like a finished build.
+    _clusters.clear();
+    _clusterGroups.clear();
+    SpillDirectory spillDirectory(config.spillDirectory.empty() ? std::filesystem::temp_directory_path() : std::filesystem::path(config.spillDirectory));
+    std::cerr << "--- Begin Streaming Build : " << chunkRanges.size() << " chunks of <= " << chunkTriangleNum << " tris ---\n\n";
+
+    std::vector<SpillChunk> chunks;
+    std::vector<MergeNode> nodes;
+    auto spillFileName = [&] { return (spillDirectory.GetPath() / ("vmesh_chunk_" + std::to_string(chunks.size()) + ".bin")).string(); };
+
+    for (auto [begin, end] : chunkRanges) {
+        std::vector<glm::vec3> vertices;
+        std::vector<uint32_t> indices;
+        std::unordered_map<uint32_t, uint32_t> mp;
+        for (uint32_t i = begin; i < end; i++) {
+            for (uint32_t k = 0; k < 3; k++) {
+                uint32_t vertId = mesh.indices[triangles[i] * 3 + k];
+                auto it = mp.find(vertId);
+                if (it == mp.end()) {
+                    it = mp.insert({ vertId, (uint32_t)vertices.size() }).first;
+                    vertices.push_back(mesh.vertices[vertId]);
+                }
+                indices.push_back(it->second);
+            }
+        }
+        std::unordered_map<uint32_t, uint32_t>().swap(mp);
+
+        RemoveDuplicates(vertices, indices, context.weld, &context.scheduler);
+        if (indices.empty()) continue;
+
+        std::vector<Cluster> clusters;
+        std::vector<ClusterGroup> clusterGroups;
+        Cluster::BuildClusters(vertices, indices, clusters, &context.scheduler, context.partition);
+        std::vector<glm::vec3>().swap(vertices);
+        std::vector<uint32_t>().swap(indices);
+
+        LevelState state;
+        BuildLevels(clusters, clusterGroups, state, chunkContext, false);
+        nodes.push_back(SpillLevels(clusters, clusterGroups, state, spillFileName(), chunks));
+        RecordStageMemory("chunk " + std::to_string(nodes.size() - 1));
+    }
+    timer.log("Success build " + std::to_string(nodes.size()) + " chunks");
+    if (nodes.empty()) {
+        _mipLevelNums = 0;
+        throw std::runtime_error("the mesh has no triangles left after welding");
+    }
+
+    // merge the tops of neighbouring chunks, in split order so that neighbours in the list are neighbours in space,
+    // until all of them fit one chunk. A merge frees the borders between its nodes only and spills what it built below
+    // its own top, so no more than about one chunk of tops is in core at a time, however many chunks there are.
+    for (uint32_t round = 0; nodes.size() > 1; round++) {
+        uint64_t totalTriangleNum = 0;
+        for (const auto& node : nodes) totalTriangleNum += node.triangleNum;
+        if (totalTriangleNum <= chunkTriangleNum)
+            break;
+
+        std::vector<MergeNode> mergedNodes;
+        for (uint32_t begin = 0; begin < nodes.size();) {
+            // at least two nodes, so every round has fewer of them.
+            uint32_t end = begin + 1;
+            uint64_t triangleNum = nodes[begin].triangleNum;
+            while (end < nodes.size() && (end - begin < 2 || triangleNum + nodes[end].triangleNum <= chunkTriangleNum))
+                triangleNum += nodes[end++].triangleNum;
+            if (end - begin == 1) {
+                mergedNodes.push_back(std::move(nodes[begin++]));
+                continue;
+            }
+
+            std::vector<Cluster> clusters;
+            std::vector<ClusterGroup> clusterGroups;
+            LevelState state;
+            for (uint32_t i = begin; i < end; i++) {
+                state.mipLevel = std::max(state.mipLevel, nodes[i].mipLevel);
+                for (auto& cluster : nodes[i].clusters) clusters.push_back(std::move(cluster));
+                nodes[i] = MergeNode();
+            }
+            BuildLevels(clusters, clusterGroups, state, chunkContext, false);
+            mergedNodes.push_back(SpillLevels(clusters, clusterGroups, state, spillFileName(), chunks));
+            begin = end;
+        }
+        nodes = std::move(mergedNodes);
+        RecordStageMemory("merge round " + std::to_string(round));
+    }
+
+    // the last merge is rooted, the open borders of the mesh are free to collapse now.
+    std::vector<Cluster> topClusters;
+    LevelState topState;
+    for (auto& node : nodes) {
+        topState.mipLevel = std::max(topState.mipLevel, node.mipLevel);
+        for (auto& cluster : node.clusters) topClusters.push_back(std::move(cluster));
+    }
+    std::vector<MergeNode>().swap(nodes);
+    std::cerr << "--- Begin Merge Levels : " << topClusters.size() << " clusters ---\n\n";
+    std::vector<ClusterGroup> topGroups;
+    BuildLevels(topClusters, topGroups, topState, context, true);
+    _mipLevelNums = topState.mipLevel + 1;
+    RecordStageMemory("merge levels");
+
+    // reload the spilled chunks and merges; final ids are [spilled clusters in spill order ... | last merge clusters ...].
+    uint32_t spillClusterNum = 0, spillGroupNum = 0;
+    for (const auto& chunk : chunks) {
+        spillClusterNum += chunk.clusterNum;
+        spillGroupNum += chunk.groupNum;
+    }
+
+    _clusters.clear();
+    _clusterGroups.clear();
+    _clusters.reserve(spillClusterNum + topClusters.size());
+    _clusterGroups.reserve(spillGroupNum + topGroups.size());
+
+    uint32_t clusterBase = 0, groupBase = 0;
+    for (const auto& chunk : chunks) {
+        std::ifstream in(chunk.fileName, std::ios::binary);
+        for (uint32_t i = 0; i < chunk.clusterNum; i++) {
+            Cluster cluster;
+            ClusterIO::ReadCluster(in, cluster);
+            cluster.groupId += groupBase;
+            _clusters.push_back(std::move(cluster));
+        }
+        for (uint32_t i = 0; i < chunk.groupNum; i++) {
+            ClusterGroup clusterGroup;
+            ClusterIO::ReadClusterGroup(in, clusterGroup);
+            for (auto& clusterId : clusterGroup.clusters) clusterId += clusterBase;
+            for (auto& [clusterId, _] : clusterGroup.externalEdges) clusterId += clusterBase;
+            _clusterGroups.push_back(std::move(clusterGroup));
+        }
+        if (!in) {
+            _clusters.clear();
+            _clusterGroups.clear();
+            throw std::runtime_error("cannot reload chunk from " + chunk.fileName);
+        }
+        in.close();
+        std::filesystem::remove(chunk.fileName);
+
+        clusterBase += chunk.clusterNum;
+        groupBase += chunk.groupNum;
+    }
+
+    for (auto& cluster : topClusters) {
+        cluster.groupId += spillGroupNum;
+        _clusters.push_back(std::move(cluster));
+    }
+    for (auto& clusterGroup : topGroups) {
+        for (auto& clusterId : clusterGroup.clusters) clusterId += spillClusterNum;
+        for (auto& [clusterId, _] : clusterGroup.externalEdges) clusterId += spillClusterNum;
+        _clusterGroups.push_back(std::move(clusterGroup));
+    }
+    RecordStageMemory("reload chunks");
 
     std::cout << "\nThe total num of clusters is: " << _clusters.size() << "\n\n";
     std::cout << "--- End Process Mesh ---\n\n";
 }
-}
\ No newline at end of file
+}
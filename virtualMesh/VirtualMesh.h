@@ -1,23 +1,78 @@
 #pragma once
 
+#include "BuildCache.h"
+#include "BuildReport.h"
 #include "Cluster.h"
 #include "Mesh.h"
+#include "Scheduler.h"
+#include "timer.h"
+#include <functional>
+#include <string>
 #include <vector>
 
 
 namespace Core {
+struct BuildConfig {
+    uint32_t threadNum = 0; // 0 : use all hardware threads, the packed data is the same for any thread num
+    uint64_t memoryBudget = 0; // bytes of build data, above it the mesh builds in chunks of about this size and their tops merge with their neighbours, all spilling their finished levels; the returned DAG is in core. 0 : always in core
+    uint64_t buildBytesPerTriangle = 768; // estimated in-core build peak per input triangle, the bench prints the measured one as build-memory
+    uint64_t memoryLimit = 0; // bytes of tracked memory in the whole process (see Util::MemoryTracker), passing it throws Util::MemoryLimitExceeded, 0 : off
+    std::string spillDirectory; // streaming builds spill chunks in a directory of their own under it, empty : system temp directory; a failed spill throws std::runtime_error
+    std::string checkpointDirectory; // snapshot after every DAG level and resume from it, in-core builds only (a streaming one throws std::invalid_argument), empty : off
+    std::string groupCacheDirectory; // content-addressed cache of parent clusters per group, empty : off
+    std::string reportFileName; // JSON statistics of the finished DAG, empty : off
+    PartitionConfig partition; // strategy (Spatial : METIS free, for quick previews) and edge weighting of the graphs
+    SimplifierConfig simplifier; // core of the group simplification, and lazy re-evaluation
+    WeldConfig weld; // position tolerance of the weld before clustering
+};
+
+// what the build stages share while one Build call runs.
+struct BuildContext {
+    Util::Scheduler& scheduler;
+    const GroupCache& groupCache;
+    const PartitionConfig& partition;
+    const SimplifierConfig& simplifier;
+    const WeldConfig& weld;
+    std::function<bool(const glm::vec3&, const glm::vec3&)> isSeam; // streaming builds : edges to chunks not merged yet, they stay locked
+};
+
 class VirtualMesh final {
 public:
-    void Build(Mesh& mesh);
+    void Build(Mesh& mesh, const BuildConfig& config = {});
     //void Compact(Mesh& mesh);
 
     const std::vector<Cluster>& GetClusters() const { return _clusters; }
     const std::vector<ClusterGroup>& GetClusterGroups() const { return _clusterGroups; }
     const uint32_t& GetMipLevelNums() const { return _mipLevelNums; }
+    const std::vector<StageMemory>& GetStageMemory() const { return _stageMemory; }
+    const std::vector<PartitionQuality>& GetPartitionQuality() const { return _partitionQuality; }
+
+    // the words Encode writes, laid out as PackedLayout says. Clusters pack on the scheduler into their own words.
+    void Pack(std::vector<uint32_t>& packedData, Util::Scheduler* scheduler = nullptr) const;
+
+    // rough peak of the transient build data (simplifier tables, edge links, graphs, clusters) for an in-core build.
+    static uint64_t EstimateBuildMemory(uint64_t triangleNum, uint64_t bytesPerTriangle);
 
 private:
     std::vector<Cluster> _clusters;
     std::vector<ClusterGroup> _clusterGroups;
     uint32_t _mipLevelNums;
+    std::vector<StageMemory> _stageMemory;
+    Util::Timer _stageTimer; // since the last recorded stage
+    std::vector<PartitionQuality> _partitionQuality;
+
+    void RecordStageMemory(const std::string& stage);
+    void WriteReport(const std::string& fileName, Util::Scheduler* scheduler) const;
+    void ComparePartitions(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, const BuildContext& context);
+    void BuildStreaming(Mesh& mesh, const BuildConfig& config, const BuildContext& context);
+
+    static void RemoveDuplicates(std::vector<glm::vec3>& vertices, std::vector<uint32_t>& indices, const WeldConfig& config, Util::Scheduler* scheduler);
+    // isRooted : reduce to a single root group, growing the groups of a level that does not shrink. Else stop at
+    // that level, as streaming chunks and merges do; they relax like a rooted build but keep the seams of the context locked.
+    static void BuildLevels(std::vector<Cluster>& clusters, std::vector<ClusterGroup>& clusterGroups, LevelState& state, const BuildContext& context,
+        bool isRooted, const std::function<void(const LevelState&)>& onLevelDone = nullptr);
+    // returns the groups that did not simplify into fewer clusters.
+    static uint32_t BuildParentLevel(std::vector<Cluster>& clusters, std::vector<ClusterGroup>& clusterGroups, uint32_t groupOffset, const BuildContext& context);
+    static void BuildRootGroup(std::vector<Cluster>& clusters, std::vector<ClusterGroup>& clusterGroups, const LevelState& state);
 };
-}
\ No newline at end of file
+}
@@ -8,10 +8,12 @@
 namespace Vk {
 	class ComputePipeline final {
 	public:
-		ComputePipeline(const Device& device, const DescriptorSetManager& descriptorSetManager, uint32_t pushConstantSize) : _device(device.GetDevice())
+		// shaderDefines : macros the compute shader is compiled with.
+		ComputePipeline(const Device& device, const DescriptorSetManager& descriptorSetManager, uint32_t pushConstantSize,
+			const std::vector<std::pair<std::string, std::string>>& shaderDefines = {}) : _device(device.GetDevice())
 		{
 			// Load shaders.
-			auto comp_code = ShaderModule::ReadFile("shaders/shader.comp", shaderc_glsl_compute_shader);
+			auto comp_code = ShaderModule::ReadFile("shaders/shader.comp", shaderc_glsl_compute_shader, false, shaderDefines);
 
 			const ShaderModule compShader(_device, comp_code);
 
@@ -109,8 +109,8 @@ namespace Vk {
 		// todo: renderpass
 
 		// Load shaders.
-		auto vert_code = ShaderModule::ReadFile(info.shaderName.first, shaderc_glsl_vertex_shader);
-		auto frag_code = ShaderModule::ReadFile(info.shaderName.second, shaderc_glsl_fragment_shader);
+		auto vert_code = ShaderModule::ReadFile(info.shaderName.first, shaderc_glsl_vertex_shader, false, info.shaderDefines);
+		auto frag_code = ShaderModule::ReadFile(info.shaderName.second, shaderc_glsl_fragment_shader, false, info.shaderDefines);
 
 		const ShaderModule vertShader(_device, vert_code);
 		const ShaderModule fragShader(_device, frag_code);
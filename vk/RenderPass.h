@@ -11,6 +11,7 @@ namespace Vk {
 		uint32_t compareOp;
 		bool useInstance;
 		std::pair<std::string, std::string> shaderName;
+		std::vector<std::pair<std::string, std::string>> shaderDefines;		// macros of both shaders
 
 		std::vector<VkFormat> colorAttachmentFormats;
 		VkFormat depthAttachmentFormat;
@@ -75,7 +75,8 @@ std::vector<char> ShaderModule::ReadFile(const std::string& filename)
 
 std::vector<uint32_t> ShaderModule::ReadFile(const std::string& filename,
     shaderc_shader_kind kind,
-    bool optimize)
+    bool optimize,
+    const std::vector<std::pair<std::string, std::string>>& defines)
 {
     static auto read_file = [](const std::string& fn) -> std::string {
         std::ifstream fin(fn, std::ios::in | std::ios::binary);
@@ -96,7 +97,9 @@ std::vector<uint32_t> ShaderModule::ReadFile(const std::string& filename,
     shaderc::CompileOptions options;
 
     // Just like -DMY_DEFINE=1
-    // options.AddMacroDefinition("MY_DEFINE", "1");
+    for (const auto& [name, value] : defines) {
+        options.AddMacroDefinition(name, value);
+    }
     if (optimize) {
         options.SetOptimizationLevel(shaderc_optimization_level_size);
     }
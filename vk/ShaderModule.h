@@ -3,6 +3,7 @@
 #include "VkConfig.h"
 #include <shaderc/shaderc.hpp>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace Vk {
@@ -18,7 +19,9 @@ namespace Vk {
 		const VkDevice& Device() const { return device_; }
 
 		VkPipelineShaderStageCreateInfo CreateShaderStage(VkShaderStageFlagBits stage) const;
-		static std::vector<uint32_t> ReadFile(const std::string& filename, shaderc_shader_kind kind, bool optimize = false);
+		// defines : (name, value) macros the source is compiled with, like -Dname=value.
+		static std::vector<uint32_t> ReadFile(const std::string& filename, shaderc_shader_kind kind, bool optimize = false,
+			const std::vector<std::pair<std::string, std::string>>& defines = {});
 
 	private:
 		static std::vector<char> ReadFile(const std::string& filename);
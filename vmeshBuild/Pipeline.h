@@ -0,0 +1,80 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+namespace Pipeline {
+// hands items from one stage thread to the next in order. Push blocks while capacity items wait, so a fast stage
+// runs at most that far ahead and the items in flight stay bounded. Pop blocks while the queue is empty and returns
+// nothing once it is closed and drained.
+template <typename T>
+class BoundedQueue final {
+public:
+    BoundedQueue(uint32_t capacity)
+        : _capacity(capacity ? capacity : 1)
+    {
+    }
+
+    void Push(T item)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _notFull.wait(lock, [&] { return _items.size() < _capacity; });
+        _items.push_back(std::move(item));
+        _notEmpty.notify_one();
+    }
+
+    // no more pushes, the consumer still gets what is queued.
+    void Close()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _isClosed = true;
+        _notEmpty.notify_all();
+    }
+
+    std::optional<T> Pop()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _notEmpty.wait(lock, [&] { return !_items.empty() || _isClosed; });
+        if (_items.empty())
+            return std::nullopt;
+        T item = std::move(_items.front());
+        _items.pop_front();
+        _notFull.notify_one();
+        return item;
+    }
+
+private:
+    const uint32_t _capacity;
+    std::deque<T> _items;
+    bool _isClosed = false;
+    std::mutex _mutex;
+    std::condition_variable _notFull;
+    std::condition_variable _notEmpty;
+};
+
+// counts the items a stage has finished, so another stage can wait until it has caught up.
+class Progress final {
+public:
+    void Done()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _doneNum++;
+        _changed.notify_all();
+    }
+
+    // blocks until at least doneNum items are finished.
+    void Wait(uint64_t doneNum)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _changed.wait(lock, [&] { return _doneNum >= doneNum; });
+    }
+
+private:
+    uint64_t _doneNum = 0;
+    std::mutex _mutex;
+    std::condition_variable _changed;
+};
+}
@@ -0,0 +1,366 @@
+#include "BuildReport.h"
+#include "Mesh.h"
+#include "Pipeline.h"
+#include "VirtualMesh.h"
+#include "timer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Usage: vmesh-build [options] <mesh file | directory | manifest .list> ...
+// Builds the cluster DAG of every mesh and writes its packed data as <mesh name>.txt, the file the applications load,
+// without a window or a GPU. Directories are searched recursively for meshes. A manifest lists one mesh file or
+// directory per line, relative to the manifest; empty lines and lines starting with # are skipped.
+// The assets go through three stages, one thread each : load, build (weld, clusters, DAG) and encode (pack, write).
+// Bounded queues sit between them, so one asset loads and another is written while a third builds.
+// The memory tracker is process wide, so with --report a build waits until the previous asset is encoded and released;
+// the stage peaks in each report are then those of its own asset only.
+//   --out <dir>          write the packed files there instead of next to the meshes
+//   --threads <n>        threads of the build stage, 0 (default) : all hardware threads
+//   --queue <n>          assets that may wait between two stages, 1 by default
+//   --budget <bytes>     stream the build of assets estimated above this, 0 (default) : always in core
+//   --strategy <name>    bisection (default), kway or spatial
+//   --weld <epsilon>     merge vertices closer than this, 0 (default) : equal positions only
+//   --cache <dir>        group cache shared by all assets
+//   --report             also write a <mesh name>.json build report next to each packed file, builds no longer overlap encodes
+//   --timings <file>     per asset stage timings as tab separated values
+//   --verbose            keep the log of the build stages, it interleaves between assets
+// The exit code is -1 when any asset fails.
+
+// swallows the build log, safe to write from all stage threads at once.
+class NullBuffer final : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+struct Asset {
+    std::string meshFileName;
+    std::string packedFileName;
+    Core::Mesh mesh;
+    std::unique_ptr<Core::VirtualMesh> vmesh;
+    std::string error; // empty : built and written
+
+    uint32_t triangleNum = 0;
+    uint32_t clusterNum = 0;
+    uint64_t packedBytes = 0;
+    uint64_t fingerprint = 0;
+    double loadMilliseconds = 0;
+    double weldMilliseconds = 0;
+    double clusterMilliseconds = 0; // base level clusters
+    double dagMilliseconds = 0; // levels, or chunks and merge of a streaming build
+    double encodeMilliseconds = 0;
+    double writeMilliseconds = 0;
+};
+
+static bool IsMeshFile(const std::filesystem::path& path)
+{
+    static const std::set<std::string> extensions = { ".obj", ".ply", ".fbx", ".gltf", ".glb", ".stl", ".dae", ".3ds", ".off" };
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+    return extensions.count(extension) != 0;
+}
+
+// mesh files of one argument or manifest line, a directory in file name order so runs list assets the same way.
+static bool CollectMeshes(const std::filesystem::path& path, std::vector<std::string>& meshFileNames, uint32_t depth = 0)
+{
+    std::error_code error;
+    if (std::filesystem::is_directory(path, error)) {
+        std::vector<std::string> fileNames;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(path, error)) {
+            if (entry.is_regular_file() && IsMeshFile(entry.path()))
+                fileNames.push_back(entry.path().string());
+        }
+        std::sort(fileNames.begin(), fileNames.end());
+        meshFileNames.insert(meshFileNames.end(), fileNames.begin(), fileNames.end());
+        return true;
+    }
+
+    if (path.extension() == ".list") {
+        std::ifstream in(path);
+        if (!in || depth > 8) {
+            std::cerr << "Error reading manifest " << path.string() << "\n";
+            return false;
+        }
+        std::string line;
+        while (std::getline(in, line)) {
+            line.erase(0, line.find_first_not_of(" \t"));
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            if (line.empty() || line[0] == '#')
+                continue;
+            std::filesystem::path entry(line);
+            if (entry.is_relative())
+                entry = path.parent_path() / entry;
+            if (!CollectMeshes(entry, meshFileNames, depth + 1))
+                return false;
+        }
+        return true;
+    }
+
+    if (!std::filesystem::is_regular_file(path, error)) {
+        std::cerr << "Error: no mesh file, directory or manifest at " << path.string() << "\n";
+        return false;
+    }
+    meshFileNames.push_back(path.string());
+    return true;
+}
+
+// splits the stage times the build recorded into weld, clusters and DAG.
+static void SplitBuildTimes(const Core::VirtualMesh& vmesh, Asset& asset)
+{
+    for (const auto& stage : vmesh.GetStageMemory()) {
+        if (stage.stage == "weld")
+            asset.weldMilliseconds += stage.milliseconds;
+        else if (stage.stage == "build clusters")
+            asset.clusterMilliseconds += stage.milliseconds;
+        else
+            asset.dagMilliseconds += stage.milliseconds;
+    }
+}
+
+static void EncodeAsset(Asset& asset, bool isWritingReport)
+{
+    Util::Timer timer;
+    std::vector<uint32_t> packedData;
+    asset.vmesh->Pack(packedData);
+    asset.fingerprint = Core::BuildReport::Fingerprint(packedData);
+    asset.packedBytes = packedData.size() * sizeof(uint32_t);
+    asset.clusterNum = asset.vmesh->GetClusters().size();
+    asset.encodeMilliseconds = timer.timeDuration() * 0.001;
+
+    timer.reset();
+    std::ofstream out(asset.packedFileName, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(packedData.data()), asset.packedBytes);
+    if (!out) {
+        asset.error = "cannot write " + asset.packedFileName;
+        return;
+    }
+    if (isWritingReport) {
+        Core::BuildReport report;
+        Core::BuildReport::Collect(*asset.vmesh, report);
+        report.fingerprint = asset.fingerprint;
+        std::string reportFileName = asset.packedFileName.substr(0, asset.packedFileName.find_last_of('.')) + ".json";
+        if (!report.WriteJson(reportFileName))
+            asset.error = "cannot write " + reportFileName;
+    }
+    asset.writeMilliseconds = timer.timeDuration() * 0.001;
+}
+
+static std::string FormatAsset(const Asset& asset)
+{
+    std::string name = std::filesystem::path(asset.meshFileName).filename().string();
+    char line[512];
+    if (!asset.error.empty()) {
+        snprintf(line, sizeof(line), "%-24s failed : %s\n", name.c_str(), asset.error.c_str());
+    } else {
+        snprintf(line, sizeof(line), "%-24s %9u tris %6u clusters  load %8.1f  weld %7.1f  clusters %8.1f  dag %9.1f  encode %7.1f  write %7.1f ms  %s\n",
+            name.c_str(), asset.triangleNum, asset.clusterNum, asset.loadMilliseconds, asset.weldMilliseconds, asset.clusterMilliseconds,
+            asset.dagMilliseconds, asset.encodeMilliseconds, asset.writeMilliseconds, Core::BuildReport::FormatFingerprint(asset.fingerprint).c_str());
+    }
+    return line;
+}
+
+static bool WriteTimings(const std::string& fileName, const std::vector<std::unique_ptr<Asset>>& assets)
+{
+    std::ofstream out(fileName);
+    out << "asset\ttriangles\tclusters\tload_ms\tweld_ms\tclusters_ms\tdag_ms\tencode_ms\twrite_ms\tpacked_bytes\tfingerprint\terror\n";
+    for (const auto& asset : assets) {
+        out << asset->meshFileName << "\t" << asset->triangleNum << "\t" << asset->clusterNum << "\t" << asset->loadMilliseconds << "\t"
+            << asset->weldMilliseconds << "\t" << asset->clusterMilliseconds << "\t" << asset->dagMilliseconds << "\t"
+            << asset->encodeMilliseconds << "\t" << asset->writeMilliseconds << "\t" << asset->packedBytes << "\t"
+            << (asset->error.empty() ? Core::BuildReport::FormatFingerprint(asset->fingerprint) : "") << "\t" << asset->error << "\n";
+    }
+    return static_cast<bool>(out);
+}
+
+int main(int argc, char** argv)
+{
+    Core::BuildConfig config;
+    std::string outDirectory, timingsFileName;
+    uint32_t queueSize = 1;
+    bool isWritingReport = false;
+    bool isVerbose = false;
+    std::vector<std::string> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--out" && hasValue)
+            outDirectory = argv[++i];
+        else if (arg == "--threads" && hasValue)
+            config.threadNum = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--queue" && hasValue)
+            queueSize = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--budget" && hasValue)
+            config.memoryBudget = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--weld" && hasValue)
+            config.weld.epsilon = std::max(0.f, float(std::atof(argv[++i])));
+        else if (arg == "--cache" && hasValue)
+            config.groupCacheDirectory = argv[++i];
+        else if (arg == "--timings" && hasValue)
+            timingsFileName = argv[++i];
+        else if (arg == "--report")
+            isWritingReport = true;
+        else if (arg == "--verbose")
+            isVerbose = true;
+        else if (arg == "--strategy" && hasValue) {
+            std::string name = argv[++i];
+            if (name == "bisection")
+                config.partition.strategy = Core::PartitionStrategy::Bisection;
+            else if (name == "kway")
+                config.partition.strategy = Core::PartitionStrategy::KWay;
+            else if (name == "spatial")
+                config.partition.strategy = Core::PartitionStrategy::Spatial;
+            else {
+                std::cerr << "Error: unknown partition strategy " << name << "\n";
+                return -1;
+            }
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Error: unknown option " << arg << "\n";
+            return -1;
+        } else
+            inputs.push_back(arg);
+    }
+    if (inputs.empty()) {
+        std::cerr << "Usage: vmesh-build [--out dir] [--threads n] [--queue n] [--budget bytes] [--strategy bisection|kway|spatial] "
+                     "[--weld epsilon] [--cache dir] [--report] [--timings file] [--verbose] <mesh file | directory | manifest .list> ...\n";
+        return -1;
+    }
+
+    std::vector<std::string> meshFileNames;
+    for (const auto& input : inputs) {
+        if (!CollectMeshes(input, meshFileNames))
+            return -1;
+    }
+    if (meshFileNames.empty()) {
+        std::cerr << "Error: no meshes found\n";
+        return -1;
+    }
+    if (!outDirectory.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(outDirectory, error);
+        if (error) {
+            std::cerr << "Error creating " << outDirectory << ": " << error.message() << "\n";
+            return -1;
+        }
+    }
+
+    // packed files are named after the mesh as the applications expect, two meshes must not land on one.
+    std::vector<std::unique_ptr<Asset>> assets;
+    std::set<std::string> packedFileNames;
+    for (const auto& meshFileName : meshFileNames) {
+        auto asset = std::make_unique<Asset>();
+        asset->meshFileName = meshFileName;
+        std::filesystem::path packedPath(meshFileName);
+        packedPath.replace_extension(".txt");
+        if (!outDirectory.empty())
+            packedPath = std::filesystem::path(outDirectory) / packedPath.filename();
+        asset->packedFileName = packedPath.string();
+        if (!packedFileNames.insert(std::filesystem::absolute(packedPath).lexically_normal().string()).second) {
+            std::cerr << "Error: more than one mesh writes " << asset->packedFileName << "\n";
+            return -1;
+        }
+        assets.push_back(std::move(asset));
+    }
+
+    // the stages log through std::cout and std::cerr, this tool reports through the original buffers.
+    std::streambuf* coutBuffer = std::cout.rdbuf();
+    std::streambuf* cerrBuffer = std::cerr.rdbuf();
+    std::ostream out(coutBuffer);
+    NullBuffer nullBuffer;
+    if (!isVerbose) {
+        std::cout.rdbuf(&nullBuffer);
+        std::cerr.rdbuf(&nullBuffer);
+    }
+
+    out << "Building " << assets.size() << " assets with " << (config.threadNum ? config.threadNum : std::max(1u, std::thread::hardware_concurrency()))
+        << " build threads\n";
+    Util::Timer wallTimer;
+    Pipeline::BoundedQueue<Asset*> buildQueue(queueSize), encodeQueue(queueSize);
+    Pipeline::Progress encodeProgress;
+
+    std::thread loader([&] {
+        for (auto& asset : assets) {
+            Util::Timer timer;
+            if (!asset->mesh.LoadMesh(asset->meshFileName))
+                asset->error = "cannot load " + asset->meshFileName;
+            else if (asset->mesh.indices.empty())
+                asset->error = "no triangles in " + asset->meshFileName;
+            asset->triangleNum = asset->mesh.indices.size() / 3;
+            asset->loadMilliseconds = timer.timeDuration() * 0.001;
+            buildQueue.Push(asset.get());
+        }
+        buildQueue.Close();
+    });
+
+    std::thread encoder([&] {
+        while (auto asset = encodeQueue.Pop()) {
+            if ((*asset)->error.empty()) {
+                try {
+                    EncodeAsset(**asset, isWritingReport);
+                } catch (const std::exception& e) {
+                    (*asset)->error = e.what();
+                }
+            }
+            (*asset)->vmesh.reset();
+            out << FormatAsset(**asset) << std::flush;
+            encodeProgress.Done();
+        }
+    });
+
+    // the build stage runs here, one asset at a time on all of the build threads.
+    uint64_t builtNum = 0;
+    while (auto asset = buildQueue.Pop()) {
+        Asset& current = **asset;
+        if (isWritingReport)
+            encodeProgress.Wait(builtNum); // the DAG and packed words of the previous asset would count in this one's peaks
+        if (current.error.empty()) {
+            try {
+                current.vmesh = std::make_unique<Core::VirtualMesh>();
+                current.vmesh->Build(current.mesh, config);
+                SplitBuildTimes(*current.vmesh, current);
+            } catch (const std::exception& e) {
+                current.error = e.what();
+                current.vmesh.reset();
+            }
+        }
+        current.mesh = Core::Mesh();
+        encodeQueue.Push(&current);
+        builtNum++;
+    }
+    encodeQueue.Close();
+    loader.join();
+    encoder.join();
+    double wallMilliseconds = wallTimer.timeDuration() * 0.001;
+
+    std::cout.rdbuf(coutBuffer);
+    std::cerr.rdbuf(cerrBuffer);
+
+    uint32_t failedNum = 0;
+    double stageMilliseconds = 0;
+    for (const auto& asset : assets) {
+        failedNum += !asset->error.empty();
+        stageMilliseconds += asset->loadMilliseconds + asset->weldMilliseconds + asset->clusterMilliseconds + asset->dagMilliseconds
+            + asset->encodeMilliseconds + asset->writeMilliseconds;
+    }
+    char line[256];
+    snprintf(line, sizeof(line), "%zu assets, %u failed, %.1f ms wall, %.1f ms of stages (%.2fx overlapped)\n", assets.size(), failedNum,
+        wallMilliseconds, stageMilliseconds, wallMilliseconds > 0 ? stageMilliseconds / wallMilliseconds : 0.0);
+    out << line;
+
+    if (!timingsFileName.empty() && !WriteTimings(timingsFileName, assets)) {
+        std::cerr << "Error writing timings to " << timingsFileName << "\n";
+        return -1;
+    }
+    return failedNum ? -1 : 0;
+}
@@ -0,0 +1,5 @@
+target("vmesh-build")
+    add_files("*.cpp")
+    add_deps("virtualMesh", "mesh", "util")
+    add_packages("glm")
+target_end()
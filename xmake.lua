@@ -9,4 +9,7 @@ includes("meshSimplify")
 includes("virtualMesh")
 includes("util")
 includes("application")
-includes("encode")
\ No newline at end of file
+includes("encode")
+includes("inspector")
+includes("bench")
+includes("vmeshBuild")